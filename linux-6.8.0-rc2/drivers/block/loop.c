@@ -81,6 +81,7 @@ struct loop_device {
 struct loop_cmd {
 	struct list_head list_entry;
 	bool use_aio; /* use AIO interface to handle I/O */
+	bool no_nowait; /* NOWAIT attempt blocked, leave it to the worker */
 	atomic_t ref; /* only for aio */
 	long ret;
 	struct kiocb iocb;
@@ -337,6 +338,15 @@ static void lo_complete_rq(struct request *rq)
 	struct loop_cmd *cmd = blk_mq_rq_to_pdu(rq);
 	blk_status_t ret = BLK_STS_OK;
 
+	/* the NOWAIT attempt from loop_queue_rq() would have blocked */
+	if (cmd->use_aio && cmd->ret == -EAGAIN &&
+	    (cmd->iocb.ki_flags & IOCB_NOWAIT)) {
+		cmd->ret = 0;
+		cmd->no_nowait = true;
+		blk_mq_requeue_request(rq, true);
+		return;
+	}
+
 	if (!cmd->use_aio || cmd->ret < 0 || cmd->ret == blk_rq_bytes(rq) ||
 	    req_op(rq) != REQ_OP_READ) {
 		if (cmd->ret < 0)
@@ -388,7 +398,7 @@ static void lo_rw_aio_complete(struct kiocb *iocb, long ret)
 }
 
 static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
-		     loff_t pos, int rw)
+		     loff_t pos, int rw, bool nowait)
 {
 	struct iov_iter iter;
 	struct req_iterator rq_iter;
@@ -442,6 +452,8 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	cmd->iocb.ki_filp = file;
 	cmd->iocb.ki_complete = lo_rw_aio_complete;
 	cmd->iocb.ki_flags = IOCB_DIRECT;
+	if (nowait)
+		cmd->iocb.ki_flags |= IOCB_NOWAIT;
 	cmd->iocb.ki_ioprio = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_NONE, 0);
 
 	if (rw == ITER_SOURCE)
@@ -449,6 +461,13 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	else
 		ret = call_read_iter(file, &cmd->iocb, &iter);
 
+	/* nothing was issued, the caller hands the request to the worker */
+	if (nowait && ret == -EAGAIN) {
+		kfree(cmd->bvec);
+		cmd->bvec = NULL;
+		return -EAGAIN;
+	}
+
 	lo_rw_aio_do_completion(cmd);
 
 	if (ret != -EIOCBQUEUED)
@@ -486,12 +505,12 @@ static int do_req_filebacked(struct loop_device *lo, struct request *rq)
 		return lo_fallocate(lo, rq, pos, FALLOC_FL_PUNCH_HOLE);
 	case REQ_OP_WRITE:
 		if (cmd->use_aio)
-			return lo_rw_aio(lo, cmd, pos, ITER_SOURCE);
+			return lo_rw_aio(lo, cmd, pos, ITER_SOURCE, false);
 		else
 			return lo_write_simple(lo, rq, pos);
 	case REQ_OP_READ:
 		if (cmd->use_aio)
-			return lo_rw_aio(lo, cmd, pos, ITER_DEST);
+			return lo_rw_aio(lo, cmd, pos, ITER_DEST, false);
 		else
 			return lo_read_simple(lo, rq, pos);
 	default:
@@ -1835,6 +1854,78 @@ MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each hardware queue. Default:
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
 
+#ifdef CONFIG_BLK_CGROUP
+/* Would the worker charge @cmd to the cgroup of the submitter anyway? */
+static bool loop_cmd_in_current_cgroup(struct loop_cmd *cmd)
+{
+	struct cgroup_subsys_state *css;
+	bool ret;
+
+	rcu_read_lock();
+	css = task_css(current, io_cgrp_id);
+	ret = css == cmd->blkcg_css ||
+		(queue_on_root_worker(css) &&
+		 queue_on_root_worker(cmd->blkcg_css));
+	rcu_read_unlock();
+
+	return ret;
+}
+#else
+static inline bool loop_cmd_in_current_cgroup(struct loop_cmd *cmd)
+{
+	return true;
+}
+#endif
+
+/*
+ * Issue a direct I/O read or write to the backing file with IOCB_NOWAIT
+ * straight from ->queue_rq(), which saves the hop to the worker.  This is
+ * only done when the submitter is in the blkcg the worker would associate
+ * with, so cgroup writeback attribution is unchanged.  The memcg the
+ * worker sets up is the one of the same cgroup, and direct I/O doesn't
+ * charge page cache anyway.
+ *
+ * Returns false if the request has to be queued to the worker.
+ */
+static bool loop_queue_rq_nowait(struct loop_device *lo, struct loop_cmd *cmd)
+{
+	struct request *rq = blk_mq_rq_from_pdu(cmd);
+	struct cgroup_subsys_state *memcg_css = cmd->memcg_css;
+	loff_t pos = ((loff_t) blk_rq_pos(rq) << 9) + lo->lo_offset;
+	unsigned int noio_flag;
+	int rw, ret;
+
+	if (!cmd->use_aio || !(lo->lo_backing_file->f_mode & FMODE_NOWAIT))
+		return false;
+
+	if (req_op(rq) == REQ_OP_WRITE) {
+		if (lo->lo_flags & LO_FLAGS_READ_ONLY)
+			return false;
+		rw = ITER_SOURCE;
+	} else {
+		rw = ITER_DEST;
+	}
+
+	if (!loop_cmd_in_current_cgroup(cmd))
+		return false;
+
+	/*
+	 * Allocations must not recurse into I/O here either, as in
+	 * loop_process_work(): the submitter may be reclaiming memory by
+	 * writing back to this very device.
+	 */
+	noio_flag = memalloc_noio_save();
+	ret = lo_rw_aio(lo, cmd, pos, rw, true);
+	memalloc_noio_restore(noio_flag);
+	/* 'cmd' may be completed already once lo_rw_aio() returns 0 */
+	if (ret)
+		return false;
+
+	if (memcg_css)
+		css_put(memcg_css);
+	return true;
+}
+
 static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 		const struct blk_mq_queue_data *bd)
 {
@@ -1873,6 +1964,13 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 #endif
 	}
 #endif
+
+	/* a requeue after a blocked NOWAIT attempt goes to the worker */
+	if (cmd->no_nowait)
+		cmd->no_nowait = false;
+	else if (loop_queue_rq_nowait(lo, cmd))
+		return BLK_STS_OK;
+
 	loop_queue_work(lo, cmd);
 
 	return BLK_STS_OK;
@@ -2017,8 +2115,9 @@ static int loop_add(int i)
 	lo->tag_set.queue_depth = hw_queue_depth;
 	lo->tag_set.numa_node = NUMA_NO_NODE;
 	lo->tag_set.cmd_size = sizeof(struct loop_cmd);
+	/* ->queue_rq() may call into the backing file, see lo_rw_aio() */
 	lo->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_STACKING |
-		BLK_MQ_F_NO_SCHED_BY_DEFAULT;
+		BLK_MQ_F_NO_SCHED_BY_DEFAULT | BLK_MQ_F_BLOCKING;
 	lo->tag_set.driver_data = lo;
 
 	err = blk_mq_alloc_tag_set(&lo->tag_set);
@@ -37,6 +37,7 @@
 #include <linux/uaccess.h>
 #include <linux/cdev.h>
 #include <linux/io_uring/cmd.h>
+#include <linux/io_uring.h>
 #include <linux/blk-mq.h>
 #include <linux/delay.h>
 #include <linux/mm.h>
@@ -116,6 +117,12 @@ struct ublk_uring_cmd_pdu {
  */
 #define UBLK_IO_FLAG_NEED_GET_DATA 0x08
 
+/*
+ * The request's pages are registered as io_uring fixed buffer
+ * ublk_io->buf_index, see UBLK_IO_REGISTER_IO_BUF.
+ */
+#define UBLK_IO_FLAG_BUF_REGISTERED 0x10
+
 /* atomic RW with ubq->cancel_lock */
 #define UBLK_IO_FLAG_CANCELED	0x80000000
 
@@ -124,6 +131,8 @@ struct ublk_io {
 	__u64	addr;
 	unsigned int flags;
 	int res;
+	/* fixed buffer index for UBLK_IO_FLAG_BUF_REGISTERED */
+	unsigned int buf_index;
 
 	struct io_uring_cmd *cmd;
 };
@@ -597,13 +606,25 @@ static inline bool ublk_support_user_copy(const struct ublk_queue *ubq)
 	return ubq->flags & UBLK_F_USER_COPY;
 }
 
+static inline bool ublk_support_zero_copy(const struct ublk_queue *ubq)
+{
+	return ubq->flags & UBLK_F_SUPPORT_ZERO_COPY;
+}
+
+/* copy the data between request and the io command's buffer */
+static inline bool ublk_need_map_io(const struct ublk_queue *ubq)
+{
+	return !ublk_support_user_copy(ubq) && !ublk_support_zero_copy(ubq);
+}
+
 static inline bool ublk_need_req_ref(const struct ublk_queue *ubq)
 {
 	/*
-	 * read()/write() is involved in user copy, so request reference
+	 * read()/write() is involved in user copy, and a registered fixed
+	 * buffer outlives the commit in zero copy, so request reference
 	 * has to be grabbed
 	 */
-	return ublk_support_user_copy(ubq);
+	return ublk_support_user_copy(ubq) || ublk_support_zero_copy(ubq);
 }
 
 static inline void ublk_init_req_ref(const struct ublk_queue *ubq,
@@ -883,7 +904,7 @@ static int ublk_map_io(const struct ublk_queue *ubq, const struct request *req,
 {
 	const unsigned int rq_bytes = blk_rq_bytes(req);
 
-	if (ublk_support_user_copy(ubq))
+	if (!ublk_need_map_io(ubq))
 		return rq_bytes;
 
 	/*
@@ -907,7 +928,7 @@ static int ublk_unmap_io(const struct ublk_queue *ubq,
 {
 	const unsigned int rq_bytes = blk_rq_bytes(req);
 
-	if (ublk_support_user_copy(ubq))
+	if (!ublk_need_map_io(ubq))
 		return rq_bytes;
 
 	if (ublk_need_unmap_req(req)) {
@@ -1696,6 +1717,88 @@ static inline void ublk_prep_cancel(struct io_uring_cmd *cmd,
 	io_uring_cmd_mark_cancelable(cmd, issue_flags);
 }
 
+static inline struct request *__ublk_check_and_get_req(struct ublk_device *ub,
+		struct ublk_queue *ubq, int tag, size_t offset)
+{
+	struct request *req;
+
+	if (!ublk_need_req_ref(ubq))
+		return NULL;
+
+	req = blk_mq_tag_to_rq(ub->tag_set.tags[ubq->q_id], tag);
+	if (!req)
+		return NULL;
+
+	if (!ublk_get_req_ref(ubq, req))
+		return NULL;
+
+	if (unlikely(!blk_mq_request_started(req) || req->tag != tag))
+		goto fail_put;
+
+	if (!ublk_rq_has_data(req))
+		goto fail_put;
+
+	if (offset > blk_rq_bytes(req))
+		goto fail_put;
+
+	return req;
+fail_put:
+	ublk_put_req_ref(ubq, req);
+	return NULL;
+}
+
+static void ublk_io_release(void *priv)
+{
+	struct request *rq = priv;
+	struct ublk_queue *ubq = rq->mq_hctx->driver_data;
+
+	ublk_put_req_ref(ubq, rq);
+}
+
+static int ublk_register_io_buf(struct io_uring_cmd *cmd,
+		struct ublk_device *ub, struct ublk_queue *ubq,
+		struct ublk_io *io, unsigned int tag, unsigned int index,
+		unsigned int issue_flags)
+{
+	struct request *req;
+	int ret;
+
+	if (!ublk_support_zero_copy(ubq))
+		return -EINVAL;
+
+	if (!(io->flags & UBLK_IO_FLAG_OWNED_BY_SRV) ||
+	    (io->flags & UBLK_IO_FLAG_BUF_REGISTERED))
+		return -EINVAL;
+
+	/* the reference is dropped once io_uring releases the buffer */
+	req = __ublk_check_and_get_req(ub, ubq, tag, 0);
+	if (!req)
+		return -EINVAL;
+
+	ret = io_buffer_register_bvec(cmd, req, ublk_io_release, index,
+				      issue_flags);
+	if (ret) {
+		ublk_put_req_ref(ubq, req);
+		return ret;
+	}
+
+	io->flags |= UBLK_IO_FLAG_BUF_REGISTERED;
+	io->buf_index = index;
+	return 0;
+}
+
+static int ublk_unregister_io_buf(struct io_uring_cmd *cmd,
+		struct ublk_io *io, struct request *req,
+		unsigned int issue_flags)
+{
+	int ret;
+
+	ret = io_buffer_unregister_bvec(cmd, req, io->buf_index, issue_flags);
+	if (!ret)
+		io->flags &= ~UBLK_IO_FLAG_BUF_REGISTERED;
+	return ret;
+}
+
 static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 			       unsigned int issue_flags,
 			       const struct ublksrv_io_cmd *ub_cmd)
@@ -1760,7 +1863,7 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 		if (io->flags & UBLK_IO_FLAG_OWNED_BY_SRV)
 			goto out;
 
-		if (!ublk_support_user_copy(ubq)) {
+		if (ublk_need_map_io(ubq)) {
 			/*
 			 * FETCH_RQ has to provide IO buffer if NEED GET
 			 * DATA is not enabled
@@ -1768,7 +1871,7 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 			if (!ub_cmd->addr && !ublk_need_get_data(ubq))
 				goto out;
 		} else if (ub_cmd->addr) {
-			/* User copy requires addr to be unset */
+			/* User copy and zero copy require addr to be unset */
 			ret = -EINVAL;
 			goto out;
 		}
@@ -1782,7 +1885,7 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 		if (!(io->flags & UBLK_IO_FLAG_OWNED_BY_SRV))
 			goto out;
 
-		if (!ublk_support_user_copy(ubq)) {
+		if (ublk_need_map_io(ubq)) {
 			/*
 			 * COMMIT_AND_FETCH_REQ has to provide IO buffer if
 			 * NEED GET DATA is not enabled or it is Read IO.
@@ -1792,13 +1895,23 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 				goto out;
 		} else if (req_op(req) != REQ_OP_ZONE_APPEND && ub_cmd->addr) {
 			/*
-			 * User copy requires addr to be unset when command is
-			 * not zone append
+			 * User copy and zero copy require addr to be unset
+			 * when command is not zone append
 			 */
 			ret = -EINVAL;
 			goto out;
 		}
 
+		/*
+		 * The request can't be completed while its pages are still
+		 * in the io_uring buffer table, so fail the commit and let
+		 * the server retry it.
+		 */
+		if (io->flags & UBLK_IO_FLAG_BUF_REGISTERED) {
+			ret = ublk_unregister_io_buf(cmd, io, req, issue_flags);
+			if (ret)
+				goto out;
+		}
 		ublk_fill_io_cmd(io, cmd, ub_cmd->addr);
 		ublk_commit_completion(ub, ub_cmd);
 		break;
@@ -1808,6 +1921,20 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 		ublk_fill_io_cmd(io, cmd, ub_cmd->addr);
 		ublk_handle_need_get_data(ub, ub_cmd->q_id, ub_cmd->tag);
 		break;
+	case UBLK_IO_REGISTER_IO_BUF:
+		if (ub_cmd->addr > U16_MAX)
+			goto out;
+		ret = ublk_register_io_buf(cmd, ub, ubq, io, tag, ub_cmd->addr,
+					   issue_flags);
+		goto out;
+	case UBLK_IO_UNREGISTER_IO_BUF:
+		ret = -EINVAL;
+		if (!(io->flags & UBLK_IO_FLAG_BUF_REGISTERED) ||
+		    io->buf_index != ub_cmd->addr)
+			goto out;
+		req = blk_mq_tag_to_rq(ub->tag_set.tags[ubq->q_id], tag);
+		ret = ublk_unregister_io_buf(cmd, io, req, issue_flags);
+		goto out;
 	default:
 		goto out;
 	}
@@ -1821,36 +1948,6 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 	return -EIOCBQUEUED;
 }
 
-static inline struct request *__ublk_check_and_get_req(struct ublk_device *ub,
-		struct ublk_queue *ubq, int tag, size_t offset)
-{
-	struct request *req;
-
-	if (!ublk_need_req_ref(ubq))
-		return NULL;
-
-	req = blk_mq_tag_to_rq(ub->tag_set.tags[ubq->q_id], tag);
-	if (!req)
-		return NULL;
-
-	if (!ublk_get_req_ref(ubq, req))
-		return NULL;
-
-	if (unlikely(!blk_mq_request_started(req) || req->tag != tag))
-		goto fail_put;
-
-	if (!ublk_rq_has_data(req))
-		goto fail_put;
-
-	if (offset > blk_rq_bytes(req))
-		goto fail_put;
-
-	return req;
-fail_put:
-	ublk_put_req_ref(ubq, req);
-	return NULL;
-}
-
 static inline int ublk_ch_uring_cmd_local(struct io_uring_cmd *cmd,
 		unsigned int issue_flags)
 {
@@ -2412,8 +2509,9 @@ static int ublk_ctrl_add_dev(struct io_uring_cmd *cmd)
 	ub->dev_info.flags |= UBLK_F_CMD_IOCTL_ENCODE |
 		UBLK_F_URING_CMD_COMP_IN_TASK;
 
-	/* GET_DATA isn't needed any more with USER_COPY */
-	if (ublk_dev_is_user_copy(ub))
+	/* GET_DATA isn't needed any more with USER_COPY or ZERO_COPY */
+	if (ublk_dev_is_user_copy(ub) ||
+	    (ub->dev_info.flags & UBLK_F_SUPPORT_ZERO_COPY))
 		ub->dev_info.flags &= ~UBLK_F_NEED_GET_DATA;
 
 	/* Zoned storage support requires user copy feature */
@@ -2423,8 +2521,15 @@ static int ublk_ctrl_add_dev(struct io_uring_cmd *cmd)
 		goto out_free_dev_number;
 	}
 
-	/* We are not ready to support zero copy */
-	ub->dev_info.flags &= ~UBLK_F_SUPPORT_ZERO_COPY;
+	/*
+	 * The server of an unprivileged device can't be trusted with the
+	 * pages of requests
+	 */
+	if ((ub->dev_info.flags & UBLK_F_SUPPORT_ZERO_COPY) &&
+	    (ub->dev_info.flags & UBLK_F_UNPRIVILEGED_DEV)) {
+		ret = -EINVAL;
+		goto out_free_dev_number;
+	}
 
 	ub->dev_info.nr_hw_queues = min_t(unsigned int,
 			ub->dev_info.nr_hw_queues, nr_cpu_ids);
@@ -2740,7 +2845,7 @@ static int ublk_ctrl_get_features(struct io_uring_cmd *cmd)
 {
 	const struct ublksrv_ctrl_cmd *header = io_uring_sqe_cmd(cmd->sqe);
 	void __user *argp = (void __user *)(unsigned long)header->addr;
-	u64 features = UBLK_F_ALL & ~UBLK_F_SUPPORT_ZERO_COPY;
+	u64 features = UBLK_F_ALL;
 
 	if (header->len != UBLK_FEATURES_LEN || !header->addr)
 		return -EINVAL;
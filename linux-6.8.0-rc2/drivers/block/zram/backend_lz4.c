@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <linux/kernel.h>
+#include <linux/lz4.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+#include "zcomp.h"
+
+struct lz4_ctx {
+	void *mem;
+	LZ4_stream_t *cstrm;
+};
+
+/* The dictionary is digested once, streams start from a copy of it */
+static int lz4_setup_params(struct zcomp_params *params)
+{
+	LZ4_stream_t *dstrm;
+
+	if (params->level == 0)
+		params->level = LZ4_ACCELERATION_DEFAULT;
+	if (!params->dict)
+		return 0;
+
+	dstrm = kvzalloc(sizeof(*dstrm), GFP_KERNEL);
+	if (!dstrm)
+		return -ENOMEM;
+
+	LZ4_loadDict(dstrm, params->dict, params->dict_sz);
+	params->drv_data = dstrm;
+	return 0;
+}
+
+static void lz4_release_params(struct zcomp_params *params)
+{
+	kvfree(params->drv_data);
+	params->drv_data = NULL;
+}
+
+static void lz4_destroy(void *ctx)
+{
+	struct lz4_ctx *zctx = ctx;
+
+	vfree(zctx->mem);
+	kfree(zctx->cstrm);
+	kfree(zctx);
+}
+
+static void *lz4_create(struct zcomp_params *params)
+{
+	struct lz4_ctx *zctx;
+
+	zctx = kzalloc(sizeof(*zctx), GFP_KERNEL);
+	if (!zctx)
+		return NULL;
+
+	if (params->dict) {
+		zctx->cstrm = kzalloc(sizeof(*zctx->cstrm), GFP_KERNEL);
+		if (!zctx->cstrm)
+			goto error;
+	} else {
+		zctx->mem = vmalloc(LZ4_MEM_COMPRESS);
+		if (!zctx->mem)
+			goto error;
+	}
+
+	return zctx;
+
+error:
+	lz4_destroy(zctx);
+	return NULL;
+}
+
+static int lz4_compress(struct zcomp_params *params, void *ctx,
+			const void *src, unsigned int src_len,
+			void *dst, unsigned int *dst_len)
+{
+	struct lz4_ctx *zctx = ctx;
+	int ret;
+
+	if (!zctx->cstrm) {
+		ret = LZ4_compress_fast(src, dst, src_len, *dst_len,
+					params->level, zctx->mem);
+	} else {
+		memcpy(zctx->cstrm, params->drv_data, sizeof(*zctx->cstrm));
+		ret = LZ4_compress_fast_continue(zctx->cstrm, src, dst,
+						 src_len, *dst_len,
+						 params->level);
+	}
+	if (!ret)
+		return -EINVAL;
+	*dst_len = ret;
+	return 0;
+}
+
+static int lz4_decompress(struct zcomp_params *params, void *ctx,
+			  const void *src, unsigned int src_len,
+			  void *dst, unsigned int dst_len)
+{
+	int ret;
+
+	if (!params->dict)
+		ret = LZ4_decompress_safe(src, dst, src_len, dst_len);
+	else
+		ret = LZ4_decompress_safe_usingDict(src, dst, src_len,
+						    dst_len, params->dict,
+						    params->dict_sz);
+	if (ret < 0)
+		return -EINVAL;
+	return 0;
+}
+
+const struct zcomp_ops backend_lz4 = {
+	.name		= "lz4",
+	.setup_params	= lz4_setup_params,
+	.release_params	= lz4_release_params,
+	.create_ctx	= lz4_create,
+	.destroy_ctx	= lz4_destroy,
+	.compress	= lz4_compress,
+	.decompress	= lz4_decompress,
+};
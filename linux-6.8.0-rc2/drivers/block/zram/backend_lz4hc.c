@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <linux/kernel.h>
+#include <linux/lz4.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+#include "zcomp.h"
+
+struct lz4hc_ctx {
+	void *mem;
+	LZ4_streamHC_t *cstrm;
+};
+
+/* The dictionary is digested once, streams start from a copy of it */
+static int lz4hc_setup_params(struct zcomp_params *params)
+{
+	LZ4_streamHC_t *dstrm;
+
+	if (params->level == 0)
+		params->level = LZ4HC_DEFAULT_CLEVEL;
+	if (!params->dict)
+		return 0;
+
+	dstrm = kvzalloc(sizeof(*dstrm), GFP_KERNEL);
+	if (!dstrm)
+		return -ENOMEM;
+
+	LZ4_resetStreamHC(dstrm, params->level);
+	LZ4_loadDictHC(dstrm, params->dict, params->dict_sz);
+	params->drv_data = dstrm;
+	return 0;
+}
+
+static void lz4hc_release_params(struct zcomp_params *params)
+{
+	kvfree(params->drv_data);
+	params->drv_data = NULL;
+}
+
+static void lz4hc_destroy(void *ctx)
+{
+	struct lz4hc_ctx *zctx = ctx;
+
+	vfree(zctx->mem);
+	vfree(zctx->cstrm);
+	kfree(zctx);
+}
+
+static void *lz4hc_create(struct zcomp_params *params)
+{
+	struct lz4hc_ctx *zctx;
+
+	zctx = kzalloc(sizeof(*zctx), GFP_KERNEL);
+	if (!zctx)
+		return NULL;
+
+	if (params->dict) {
+		zctx->cstrm = vzalloc(sizeof(*zctx->cstrm));
+		if (!zctx->cstrm)
+			goto error;
+	} else {
+		zctx->mem = vmalloc(LZ4HC_MEM_COMPRESS);
+		if (!zctx->mem)
+			goto error;
+	}
+
+	return zctx;
+
+error:
+	lz4hc_destroy(zctx);
+	return NULL;
+}
+
+static int lz4hc_compress(struct zcomp_params *params, void *ctx,
+			  const void *src, unsigned int src_len,
+			  void *dst, unsigned int *dst_len)
+{
+	struct lz4hc_ctx *zctx = ctx;
+	int ret;
+
+	if (!zctx->cstrm) {
+		ret = LZ4_compress_HC(src, dst, src_len, *dst_len,
+				      params->level, zctx->mem);
+	} else {
+		memcpy(zctx->cstrm, params->drv_data, sizeof(*zctx->cstrm));
+		ret = LZ4_compress_HC_continue(zctx->cstrm, src, dst,
+					       src_len, *dst_len);
+	}
+	if (!ret)
+		return -EINVAL;
+	*dst_len = ret;
+	return 0;
+}
+
+static int lz4hc_decompress(struct zcomp_params *params, void *ctx,
+			    const void *src, unsigned int src_len,
+			    void *dst, unsigned int dst_len)
+{
+	int ret;
+
+	if (!params->dict)
+		ret = LZ4_decompress_safe(src, dst, src_len, dst_len);
+	else
+		ret = LZ4_decompress_safe_usingDict(src, dst, src_len,
+						    dst_len, params->dict,
+						    params->dict_sz);
+	if (ret < 0)
+		return -EINVAL;
+	return 0;
+}
+
+const struct zcomp_ops backend_lz4hc = {
+	.name		= "lz4hc",
+	.setup_params	= lz4hc_setup_params,
+	.release_params	= lz4hc_release_params,
+	.create_ctx	= lz4hc_create,
+	.destroy_ctx	= lz4hc_destroy,
+	.compress	= lz4hc_compress,
+	.decompress	= lz4hc_decompress,
+};
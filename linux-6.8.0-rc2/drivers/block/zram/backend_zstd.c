@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/zstd.h>
+
+#include "zcomp.h"
+
+/* ZSTD_CLEVEL_DEFAULT, not exported by linux/zstd.h */
+#define ZSTD_DEF_LEVEL	3
+
+struct zstd_ctx {
+	zstd_cctx *cctx;
+	zstd_dctx *dctx;
+	void *cctx_mem;
+	void *dctx_mem;
+};
+
+/*
+ * Only the level is supported, this lib/zstd has no wrappers for
+ * digested (cdict/ddict) dictionaries.
+ */
+static int zstd_setup_params(struct zcomp_params *params)
+{
+	zstd_parameters *prm;
+
+	if (params->dict)
+		return -EOPNOTSUPP;
+	if (params->level == 0)
+		params->level = ZSTD_DEF_LEVEL;
+	if (params->level < zstd_min_clevel() ||
+	    params->level > zstd_max_clevel())
+		return -EINVAL;
+
+	prm = kzalloc(sizeof(*prm), GFP_KERNEL);
+	if (!prm)
+		return -ENOMEM;
+
+	*prm = zstd_get_params(params->level, ZCOMP_MAX_SRC);
+	params->drv_data = prm;
+	return 0;
+}
+
+static void zstd_release_params(struct zcomp_params *params)
+{
+	kfree(params->drv_data);
+	params->drv_data = NULL;
+}
+
+static void zstd_destroy(void *ctx)
+{
+	struct zstd_ctx *zctx = ctx;
+
+	vfree(zctx->cctx_mem);
+	vfree(zctx->dctx_mem);
+	kfree(zctx);
+}
+
+static void *zstd_create(struct zcomp_params *params)
+{
+	zstd_parameters *prm = params->drv_data;
+	struct zstd_ctx *zctx;
+	size_t sz;
+
+	zctx = kzalloc(sizeof(*zctx), GFP_KERNEL);
+	if (!zctx)
+		return NULL;
+
+	sz = zstd_cctx_workspace_bound(&prm->cParams);
+	zctx->cctx_mem = vzalloc(sz);
+	if (!zctx->cctx_mem)
+		goto error;
+
+	zctx->cctx = zstd_init_cctx(zctx->cctx_mem, sz);
+	if (!zctx->cctx)
+		goto error;
+
+	sz = zstd_dctx_workspace_bound();
+	zctx->dctx_mem = vzalloc(sz);
+	if (!zctx->dctx_mem)
+		goto error;
+
+	zctx->dctx = zstd_init_dctx(zctx->dctx_mem, sz);
+	if (!zctx->dctx)
+		goto error;
+
+	return zctx;
+
+error:
+	zstd_destroy(zctx);
+	return NULL;
+}
+
+static int zstd_compress(struct zcomp_params *params, void *ctx,
+			 const void *src, unsigned int src_len,
+			 void *dst, unsigned int *dst_len)
+{
+	zstd_parameters *prm = params->drv_data;
+	struct zstd_ctx *zctx = ctx;
+	size_t ret;
+
+	ret = zstd_compress_cctx(zctx->cctx, dst, *dst_len, src, src_len, prm);
+	if (zstd_is_error(ret))
+		return -EINVAL;
+	*dst_len = ret;
+	return 0;
+}
+
+static int zstd_decompress(struct zcomp_params *params, void *ctx,
+			   const void *src, unsigned int src_len,
+			   void *dst, unsigned int dst_len)
+{
+	struct zstd_ctx *zctx = ctx;
+	size_t ret;
+
+	ret = zstd_decompress_dctx(zctx->dctx, dst, dst_len, src, src_len);
+	if (zstd_is_error(ret))
+		return -EINVAL;
+	return 0;
+}
+
+const struct zcomp_ops backend_zstd = {
+	.name		= "zstd",
+	.setup_params	= zstd_setup_params,
+	.release_params	= zstd_release_params,
+	.create_ctx	= zstd_create,
+	.destroy_ctx	= zstd_destroy,
+	.compress	= zstd_compress,
+	.decompress	= zstd_decompress,
+};
@@ -33,29 +33,62 @@ static const char * const backends[] = {
 #endif
 };
 
-static void zcomp_strm_free(struct zcomp_strm *zstrm)
+static const struct zcomp_ops *native_backends[] = {
+#if IS_ENABLED(CONFIG_ZRAM_ALGORITHM_PARAMS)
+	&backend_lz4,
+	&backend_lz4hc,
+	&backend_zstd,
+#endif
+};
+
+static const struct zcomp_ops *zcomp_native_backend(const char *alg)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(native_backends); i++)
+		if (!strcmp(alg, native_backends[i]->name))
+			return native_backends[i];
+	return NULL;
+}
+
+static void zcomp_strm_free(struct zcomp *comp, struct zcomp_strm *zstrm)
 {
 	if (!IS_ERR_OR_NULL(zstrm->tfm))
 		crypto_free_comp(zstrm->tfm);
-	free_pages((unsigned long)zstrm->buffer, 1);
+	if (zstrm->ctx)
+		comp->ops->destroy_ctx(zstrm->ctx);
+	kvfree(zstrm->buffer);
 	zstrm->tfm = NULL;
+	zstrm->ctx = NULL;
 	zstrm->buffer = NULL;
 }
 
 /*
- * Initialize zcomp_strm structure with ->tfm initialized by backend, and
- * ->buffer. Return a negative value on error.
+ * Initialize zcomp_strm structure with ->tfm initialized by backend (or
+ * ->ctx for native backends), and ->buffer. Return a negative value on
+ * error.
  */
 static int zcomp_strm_init(struct zcomp_strm *zstrm, struct zcomp *comp)
 {
-	zstrm->tfm = crypto_alloc_comp(comp->name, 0, 0);
+	bool failed;
+
+	if (comp->ops) {
+		zstrm->ctx = comp->ops->create_ctx(&comp->params);
+		failed = !zstrm->ctx;
+	} else {
+		zstrm->tfm = crypto_alloc_comp(comp->name, 0, 0);
+		failed = IS_ERR_OR_NULL(zstrm->tfm);
+	}
 	/*
-	 * allocate 2 pages. 1 for compressed data, plus 1 extra for the
-	 * case when compressed size is larger than the original one
+	 * allocate 2 times the largest input. 1 for compressed data, plus
+	 * 1 extra for the case when compressed size is larger than the
+	 * original one. Multi-page units make that a high order, which
+	 * may not be available when a cpu comes online.
 	 */
-	zstrm->buffer = (void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO, 1);
-	if (IS_ERR_OR_NULL(zstrm->tfm) || !zstrm->buffer) {
-		zcomp_strm_free(zstrm);
+	zstrm->buffer = kvzalloc(ZCOMP_MAX_SRC * 2, GFP_KERNEL);
+	zstrm->buffer_tag = 0;
+	if (failed || !zstrm->buffer) {
+		zcomp_strm_free(comp, zstrm);
 		return -ENOMEM;
 	}
 	return 0;
@@ -114,11 +147,11 @@ void zcomp_stream_put(struct zcomp *comp)
 	local_unlock(&comp->stream->lock);
 }
 
-int zcomp_compress(struct zcomp_strm *zstrm,
-		const void *src, unsigned int *dst_len)
+int zcomp_compress(struct zcomp *comp, struct zcomp_strm *zstrm,
+		const void *src, unsigned int src_len, unsigned int *dst_len)
 {
 	/*
-	 * Our dst memory (zstrm->buffer) is always `2 * PAGE_SIZE' sized
+	 * Our dst memory (zstrm->buffer) is always `2 * ZCOMP_MAX_SRC' sized
 	 * because sometimes we can endup having a bigger compressed data
 	 * due to various reasons: for example compression algorithms tend
 	 * to add some padding to the compressed buffer. Speaking of padding,
@@ -131,17 +164,25 @@ int zcomp_compress(struct zcomp_strm *zstrm,
 	 * the dst buffer, zram_drv will take care of the fact that
 	 * compressed buffer is too big.
 	 */
-	*dst_len = PAGE_SIZE * 2;
+	*dst_len = ZCOMP_MAX_SRC * 2;
+	zstrm->buffer_tag = 0;
+
+	if (comp->ops)
+		return comp->ops->compress(&comp->params, zstrm->ctx, src,
+					   src_len, zstrm->buffer, dst_len);
 
 	return crypto_comp_compress(zstrm->tfm,
-			src, PAGE_SIZE,
+			src, src_len,
 			zstrm->buffer, dst_len);
 }
 
-int zcomp_decompress(struct zcomp_strm *zstrm,
-		const void *src, unsigned int src_len, void *dst)
+int zcomp_decompress(struct zcomp *comp, struct zcomp_strm *zstrm,
+		const void *src, unsigned int src_len,
+		void *dst, unsigned int dst_len)
 {
-	unsigned int dst_len = PAGE_SIZE;
+	if (comp->ops)
+		return comp->ops->decompress(&comp->params, zstrm->ctx, src,
+					     src_len, dst, dst_len);
 
 	return crypto_comp_decompress(zstrm->tfm,
 			src, src_len,
@@ -169,7 +210,7 @@ int zcomp_cpu_dead(unsigned int cpu, struct hlist_node *node)
 	struct zcomp_strm *zstrm;
 
 	zstrm = per_cpu_ptr(comp->stream, cpu);
-	zcomp_strm_free(zstrm);
+	zcomp_strm_free(comp, zstrm);
 	return 0;
 }
 
@@ -195,6 +236,8 @@ void zcomp_destroy(struct zcomp *comp)
 {
 	cpuhp_state_remove_instance(CPUHP_ZCOMP_PREPARE, &comp->node);
 	free_percpu(comp->stream);
+	if (comp->ops && comp->ops->release_params)
+		comp->ops->release_params(&comp->params);
 	kfree(comp);
 }
 
@@ -202,30 +245,51 @@ void zcomp_destroy(struct zcomp *comp)
  * search available compressors for requested algorithm.
  * allocate new zcomp and initialize it. return compressing
  * backend pointer or ERR_PTR if things went bad. ERR_PTR(-EINVAL)
- * if requested algorithm is not supported, ERR_PTR(-ENOMEM) in
- * case of allocation error, or any other error potentially
- * returned by zcomp_init().
+ * if requested algorithm is not supported, ERR_PTR(-EOPNOTSUPP) if
+ * @params are set but the algorithm has no native backend,
+ * ERR_PTR(-ENOMEM) in case of allocation error, or any other error
+ * potentially returned by zcomp_init().
  */
-struct zcomp *zcomp_create(const char *alg)
+struct zcomp *zcomp_create(const char *alg, struct zcomp_params *params)
 {
+	const struct zcomp_ops *ops = NULL;
 	struct zcomp *comp;
 	int error;
 
+	if (params->level || params->dict) {
+		ops = zcomp_native_backend(alg);
+		if (!ops)
+			return ERR_PTR(-EOPNOTSUPP);
 	/*
 	 * Crypto API will execute /sbin/modprobe if the compression module
 	 * is not loaded yet. We must do it here, otherwise we are about to
 	 * call /sbin/modprobe under CPU hot-plug lock.
 	 */
-	if (!zcomp_available_algorithm(alg))
+	} else if (!zcomp_available_algorithm(alg)) {
 		return ERR_PTR(-EINVAL);
+	}
 
 	comp = kzalloc(sizeof(struct zcomp), GFP_KERNEL);
 	if (!comp)
 		return ERR_PTR(-ENOMEM);
 
 	comp->name = alg;
+	comp->ops = ops;
+	comp->params.level = params->level;
+	comp->params.dict = params->dict;
+	comp->params.dict_sz = params->dict_sz;
+	if (ops && ops->setup_params) {
+		error = ops->setup_params(&comp->params);
+		if (error) {
+			kfree(comp);
+			return ERR_PTR(error);
+		}
+	}
+
 	error = zcomp_init(comp);
 	if (error) {
+		if (ops && ops->release_params)
+			ops->release_params(&comp->params);
 		kfree(comp);
 		return ERR_PTR(error);
 	}
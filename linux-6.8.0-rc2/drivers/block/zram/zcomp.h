@@ -7,19 +7,73 @@
 #define _ZCOMP_H_
 #include <linux/local_lock.h>
 
+/*
+ * Algorithm parameters. A zero level selects the algorithm's default.
+ * The dictionary is owned by the caller of zcomp_create().
+ */
+struct zcomp_params {
+	s32 level;
+	void *dict;
+	size_t dict_sz;
+	/* set up once by the backend, e.g. a digested dictionary */
+	void *drv_data;
+};
+
+/*
+ * Largest input of a single compression: a page, or a multi-page unit
+ * when zram compresses contiguous pages together.
+ */
+#ifdef CONFIG_ZRAM_MULTI_PAGES
+#define ZCOMP_MAX_ORDER		CONFIG_ZRAM_MULTI_PAGES_ORDER
+#else
+#define ZCOMP_MAX_ORDER		0
+#endif
+#define ZCOMP_MAX_SRC		(PAGE_SIZE << ZCOMP_MAX_ORDER)
+
 struct zcomp_strm {
-	/* The members ->buffer and ->tfm are protected by ->lock. */
+	/* The members ->buffer, ->tfm and ->ctx are protected by ->lock. */
 	local_lock_t lock;
-	/* compression/decompression buffer */
+	/* compression/decompression buffer, 2 * ZCOMP_MAX_SRC */
 	void *buffer;
+	/* set by the user to tag data it keeps in ->buffer, 0 after compress */
+	u64 buffer_tag;
 	struct crypto_comp *tfm;
+	/* context of a native backend */
+	void *ctx;
 };
 
+/*
+ * Native backends call the compression libraries directly, the crypto
+ * API has no way to pass a level or a dictionary.
+ */
+struct zcomp_ops {
+	const char *name;
+	int (*setup_params)(struct zcomp_params *params);
+	void (*release_params)(struct zcomp_params *params);
+	void *(*create_ctx)(struct zcomp_params *params);
+	void (*destroy_ctx)(void *ctx);
+	int (*compress)(struct zcomp_params *params, void *ctx,
+			const void *src, unsigned int src_len,
+			void *dst, unsigned int *dst_len);
+	int (*decompress)(struct zcomp_params *params, void *ctx,
+			  const void *src, unsigned int src_len,
+			  void *dst, unsigned int dst_len);
+};
+
+#if IS_ENABLED(CONFIG_ZRAM_ALGORITHM_PARAMS)
+extern const struct zcomp_ops backend_lz4;
+extern const struct zcomp_ops backend_lz4hc;
+extern const struct zcomp_ops backend_zstd;
+#endif
+
 /* dynamic per-device compression frontend */
 struct zcomp {
 	struct zcomp_strm __percpu *stream;
 	const char *name;
 	struct hlist_node node;
+	/* NULL when compressing through the crypto API */
+	const struct zcomp_ops *ops;
+	struct zcomp_params params;
 };
 
 int zcomp_cpu_up_prepare(unsigned int cpu, struct hlist_node *node);
@@ -27,17 +81,18 @@ int zcomp_cpu_dead(unsigned int cpu, struct hlist_node *node);
 ssize_t zcomp_available_show(const char *comp, char *buf);
 bool zcomp_available_algorithm(const char *comp);
 
-struct zcomp *zcomp_create(const char *alg);
+struct zcomp *zcomp_create(const char *alg, struct zcomp_params *params);
 void zcomp_destroy(struct zcomp *comp);
 
 struct zcomp_strm *zcomp_stream_get(struct zcomp *comp);
 void zcomp_stream_put(struct zcomp *comp);
 
-int zcomp_compress(struct zcomp_strm *zstrm,
-		const void *src, unsigned int *dst_len);
+int zcomp_compress(struct zcomp *comp, struct zcomp_strm *zstrm,
+		const void *src, unsigned int src_len, unsigned int *dst_len);
 
-int zcomp_decompress(struct zcomp_strm *zstrm,
-		const void *src, unsigned int src_len, void *dst);
+int zcomp_decompress(struct zcomp *comp, struct zcomp_strm *zstrm,
+		const void *src, unsigned int src_len,
+		void *dst, unsigned int dst_len);
 
 bool zcomp_set_max_streams(struct zcomp *comp, int num_strm);
 #endif /* _ZCOMP_H_ */
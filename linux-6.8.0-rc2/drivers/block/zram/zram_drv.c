@@ -33,6 +33,7 @@
 #include <linux/debugfs.h>
 #include <linux/cpuhotplug.h>
 #include <linux/part_stat.h>
+#include <linux/kernel_read_file.h>
 
 #include "zram_drv.h"
 
@@ -139,7 +140,8 @@ static inline bool zram_allocated(struct zram *zram, u32 index)
 {
 	return zram_get_obj_size(zram, index) ||
 			zram_test_flag(zram, index, ZRAM_SAME) ||
-			zram_test_flag(zram, index, ZRAM_WB);
+			zram_test_flag(zram, index, ZRAM_WB) ||
+			zram_test_flag(zram, index, ZRAM_MULTI_PAGES);
 }
 
 #if PAGE_SIZE != 4096
@@ -958,6 +960,84 @@ static ssize_t max_comp_streams_store(struct device *dev,
 	return len;
 }
 
+static ssize_t async_write_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	down_read(&zram->init_lock);
+	val = zram->async_write;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", val);
+}
+
+static ssize_t async_write_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change async write mode for initialized device\n");
+		return -EBUSY;
+	}
+
+	zram->async_write = val;
+	/*
+	 * Swap waits for every write of a synchronous device, which would
+	 * leave nothing for the workers to run in parallel.
+	 */
+	if (val)
+		blk_queue_flag_clear(QUEUE_FLAG_SYNCHRONOUS, zram->disk->queue);
+	else
+		blk_queue_flag_set(QUEUE_FLAG_SYNCHRONOUS, zram->disk->queue);
+	up_write(&zram->init_lock);
+
+	return len;
+}
+
+#ifdef CONFIG_ZRAM_MULTI_PAGES
+static ssize_t multi_pages_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", READ_ONCE(zram->multi_pages));
+}
+
+/*
+ * Units already stored stay readable when this is switched off, so it
+ * can be changed at any time.
+ */
+static ssize_t multi_pages_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	WRITE_ONCE(zram->multi_pages, val);
+	return len;
+}
+#endif
+
+static void comp_params_reset(struct zram *zram, u32 prio)
+{
+	struct zcomp_params *params = &zram->params[prio];
+
+	vfree(params->dict);
+	memset(params, 0, sizeof(*params));
+}
+
 static void comp_algorithm_set(struct zram *zram, u32 prio, const char *alg)
 {
 	/* Do not free statically defined compression algorithms */
@@ -965,7 +1045,91 @@ static void comp_algorithm_set(struct zram *zram, u32 prio, const char *alg)
 		kfree(zram->comp_algs[prio]);
 
 	zram->comp_algs[prio] = alg;
+	/* parameters belong to the algorithm they were set for */
+	comp_params_reset(zram, prio);
+}
+
+#ifdef CONFIG_ZRAM_ALGORITHM_PARAMS
+static int comp_params_store(struct zram *zram, u32 prio, s32 level,
+			     const char *dict_path)
+{
+	ssize_t sz = 0;
+	void *dict = NULL;
+
+	if (dict_path) {
+		sz = kernel_read_file_from_path(dict_path, 0, &dict, INT_MAX,
+						NULL, READING_POLICY);
+		if (sz < 0)
+			return sz;
+	}
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		vfree(dict);
+		pr_info("Can't change algorithm parameters for initialized device\n");
+		return -EBUSY;
+	}
+
+	comp_params_reset(zram, prio);
+	zram->params[prio].level = level;
+	zram->params[prio].dict = dict;
+	zram->params[prio].dict_sz = sz;
+	up_write(&zram->init_lock);
+	return 0;
+}
+
+/*
+ * "priority=N level=L dict=PATH": the parameters apply to the algorithm
+ * of that priority (primary by default) and are dropped when the
+ * algorithm is changed.
+ */
+static ssize_t algorithm_params_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf,
+				      size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	int prio = ZRAM_PRIMARY_COMP;
+	char *args, *param, *val;
+	char *dict_path = NULL;
+	s32 level = 0;
+	int ret;
+
+	args = skip_spaces(buf);
+	while (*args) {
+		args = next_arg(args, &param, &val);
+
+		if (!val || !*val)
+			return -EINVAL;
+
+		if (!strcmp(param, "priority")) {
+			ret = kstrtoint(val, 10, &prio);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		if (!strcmp(param, "level")) {
+			ret = kstrtoint(val, 10, &level);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		if (!strcmp(param, "dict")) {
+			dict_path = val;
+			continue;
+		}
+	}
+
+	if (prio < ZRAM_PRIMARY_COMP || prio >= ZRAM_MAX_COMPS)
+		return -EINVAL;
+
+	ret = comp_params_store(zram, prio, level, dict_path);
+	return ret ? ret : len;
 }
+#endif
 
 static ssize_t __comp_algorithm_show(struct zram *zram, u32 prio, char *buf)
 {
@@ -1249,6 +1413,100 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
  * caller should hold this table index entry's bit_spinlock to
  * indicate this index entry is accessing.
  */
+#ifdef CONFIG_ZRAM_MULTI_PAGES
+static unsigned int zram_mp_chunk_len(struct zram_mp_obj *obj, unsigned int i)
+{
+	unsigned int len = DIV_ROUND_UP(obj->comp_len, obj->nr_chunks);
+
+	return min(len, obj->comp_len - i * len);
+}
+
+/* Drops the slot's reference, the last one frees the unit */
+static void zram_mp_free_slot(struct zram *zram, u32 index)
+{
+	struct zram_mp_obj *obj = (void *)zram_get_handle(zram, index);
+	unsigned int i;
+
+	zram_clear_flag(zram, index, ZRAM_MULTI_PAGES);
+	if (!atomic_dec_and_test(&obj->refs))
+		return;
+
+	for (i = 0; i < obj->nr_chunks; i++)
+		zs_free(zram->mem_pool, obj->handles[i]);
+	atomic64_sub(obj->comp_len, &zram->stats.compr_data_size);
+	kfree(obj);
+}
+
+/*
+ * Decompresses the whole unit to the start of zstrm->buffer. The chunks
+ * are reassembled in the second half of the buffer.
+ *
+ * Pages of a unit are often read one at a time, e.g. by swap readahead
+ * or faults on neighbouring addresses, so the unit is left in the
+ * buffer and reused until this cpu's stream compresses something else.
+ */
+static int zram_mp_decompress(struct zram *zram, struct zcomp_strm *zstrm,
+			      struct zram_mp_obj *obj)
+{
+	void *stream = zstrm->buffer + ZCOMP_MAX_SRC;
+	unsigned int i, len, off = 0;
+	void *src;
+	int ret;
+
+	if (zstrm->buffer_tag == obj->id)
+		return 0;
+
+	zstrm->buffer_tag = 0;
+	for (i = 0; i < obj->nr_chunks; i++) {
+		len = zram_mp_chunk_len(obj, i);
+		src = zs_map_object(zram->mem_pool, obj->handles[i], ZS_MM_RO);
+		memcpy(stream + off, src, len);
+		zs_unmap_object(zram->mem_pool, obj->handles[i]);
+		off += len;
+	}
+
+	ret = zcomp_decompress(zram->comps[ZRAM_PRIMARY_COMP], zstrm,
+			       stream, obj->comp_len,
+			       zstrm->buffer, ZRAM_MP_PAGES * PAGE_SIZE);
+	if (!ret)
+		zstrm->buffer_tag = obj->id;
+	return ret;
+}
+
+/*
+ * Reads a page of a multi-page unit.
+ * Corresponding ZRAM slot should be locked.
+ */
+static int zram_read_mp(struct zram *zram, struct page *page, u32 index)
+{
+	struct zram_mp_obj *obj = (void *)zram_get_handle(zram, index);
+	u32 off = (index & (ZRAM_MP_PAGES - 1)) << PAGE_SHIFT;
+	struct zcomp_strm *zstrm;
+	void *dst;
+	int ret;
+
+	zstrm = zcomp_stream_get(zram->comps[ZRAM_PRIMARY_COMP]);
+	ret = zram_mp_decompress(zram, zstrm, obj);
+	if (!ret) {
+		dst = kmap_local_page(page);
+		memcpy(dst, zstrm->buffer + off, PAGE_SIZE);
+		kunmap_local(dst);
+	}
+	zcomp_stream_put(zram->comps[ZRAM_PRIMARY_COMP]);
+	return ret;
+}
+#else
+static inline void zram_mp_free_slot(struct zram *zram, u32 index)
+{
+}
+
+static inline int zram_read_mp(struct zram *zram, struct page *page,
+			       u32 index)
+{
+	return -EIO;
+}
+#endif
+
 static void zram_free_page(struct zram *zram, size_t index)
 {
 	unsigned long handle;
@@ -1285,6 +1543,11 @@ static void zram_free_page(struct zram *zram, size_t index)
 		goto out;
 	}
 
+	if (zram_test_flag(zram, index, ZRAM_MULTI_PAGES)) {
+		zram_mp_free_slot(zram, index);
+		goto out;
+	}
+
 	handle = zram_get_handle(zram, index);
 	if (!handle)
 		return;
@@ -1298,7 +1561,8 @@ out:
 	zram_set_handle(zram, index, 0);
 	zram_set_obj_size(zram, index, 0);
 	WARN_ON_ONCE(zram->table[index].flags &
-		~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB));
+		~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB |
+		  1UL << ZRAM_PENDING));
 }
 
 /*
@@ -1315,6 +1579,9 @@ static int zram_read_from_zspool(struct zram *zram, struct page *page,
 	u32 prio;
 	int ret;
 
+	if (zram_test_flag(zram, index, ZRAM_MULTI_PAGES))
+		return zram_read_mp(zram, page, index);
+
 	handle = zram_get_handle(zram, index);
 	if (!handle || zram_test_flag(zram, index, ZRAM_SAME)) {
 		unsigned long value;
@@ -1342,7 +1609,8 @@ static int zram_read_from_zspool(struct zram *zram, struct page *page,
 		ret = 0;
 	} else {
 		dst = kmap_local_page(page);
-		ret = zcomp_decompress(zstrm, src, size, dst);
+		ret = zcomp_decompress(zram->comps[prio], zstrm, src, size,
+				       dst, PAGE_SIZE);
 		kunmap_local(dst);
 		zcomp_stream_put(zram->comps[prio]);
 	}
@@ -1350,12 +1618,31 @@ static int zram_read_from_zspool(struct zram *zram, struct page *page,
 	return ret;
 }
 
+static bool zram_write_pending(struct zram *zram, u32 index)
+{
+	return READ_ONCE(zram->table[index].flags) & BIT(ZRAM_PENDING);
+}
+
+/*
+ * Wait until a queued async write of the slot has stored its data.
+ * Called and returns with the slot locked.
+ */
+static void zram_wait_pending(struct zram *zram, u32 index)
+{
+	while (unlikely(zram_test_flag(zram, index, ZRAM_PENDING))) {
+		zram_slot_unlock(zram, index);
+		wait_event(zram->wr_wait, !zram_write_pending(zram, index));
+		zram_slot_lock(zram, index);
+	}
+}
+
 static int zram_read_page(struct zram *zram, struct page *page, u32 index,
 			  struct bio *parent)
 {
 	int ret;
 
 	zram_slot_lock(zram, index);
+	zram_wait_pending(zram, index);
 	if (!zram_test_flag(zram, index, ZRAM_WB)) {
 		/* Slot should be locked through out the function call */
 		ret = zram_read_from_zspool(zram, page, index);
@@ -1429,7 +1716,8 @@ static int zram_write_page(struct zram *zram, struct page *page, u32 index)
 compress_again:
 	zstrm = zcomp_stream_get(zram->comps[ZRAM_PRIMARY_COMP]);
 	src = kmap_local_page(page);
-	ret = zcomp_compress(zstrm, src, &comp_len);
+	ret = zcomp_compress(zram->comps[ZRAM_PRIMARY_COMP], zstrm,
+			     src, PAGE_SIZE, &comp_len);
 	kunmap_local(src);
 
 	if (unlikely(ret)) {
@@ -1615,7 +1903,8 @@ static int zram_recompress(struct zram *zram, u32 index, struct page *page,
 		num_recomps++;
 		zstrm = zcomp_stream_get(zram->comps[prio]);
 		src = kmap_local_page(page);
-		ret = zcomp_compress(zstrm, src, &comp_len_new);
+		ret = zcomp_compress(zram->comps[prio], zstrm, src,
+				     PAGE_SIZE, &comp_len_new);
 		kunmap_local(src);
 
 		if (ret) {
@@ -1804,6 +2093,7 @@ static ssize_t recompress_store(struct device *dev,
 		if (zram_test_flag(zram, index, ZRAM_WB) ||
 		    zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
 		    zram_test_flag(zram, index, ZRAM_SAME) ||
+		    zram_test_flag(zram, index, ZRAM_MULTI_PAGES) ||
 		    zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
 			goto next;
 
@@ -1827,6 +2117,239 @@ release_init_lock:
 }
 #endif
 
+#ifdef CONFIG_ZRAM_MULTI_PAGES
+/*
+ * Compresses the ZRAM_MP_PAGES pages of the unit starting at @index as
+ * one stream. Returns -E2BIG if that does not pay off, the caller then
+ * stores the pages one by one, as it does on any other error.
+ */
+static int zram_write_mp(struct zram *zram, struct page **pages, u32 index)
+{
+	struct zcomp *comp = zram->comps[ZRAM_PRIMARY_COMP];
+	unsigned int comp_len, len, off, i;
+	unsigned long alloced_pages, element;
+	struct zcomp_strm *zstrm;
+	struct zram_mp_obj *obj;
+	void *src, *dst;
+	bool same;
+	int ret;
+
+	/* Same-filled pages are stored for free by the per-page path */
+	for (i = 0; i < ZRAM_MP_PAGES; i++) {
+		src = kmap_local_page(pages[i]);
+		same = page_same_filled(src, &element);
+		kunmap_local(src);
+		if (same)
+			return -E2BIG;
+	}
+
+	obj = kzalloc(sizeof(*obj), GFP_NOIO);
+	if (!obj)
+		return -ENOMEM;
+	obj->id = atomic64_inc_return(&zram->mp_next_id);
+
+	src = vm_map_ram(pages, ZRAM_MP_PAGES, NUMA_NO_NODE);
+	if (!src) {
+		kfree(obj);
+		return -ENOMEM;
+	}
+
+	zstrm = zcomp_stream_get(comp);
+	ret = zcomp_compress(comp, zstrm, src, ZRAM_MP_PAGES * PAGE_SIZE,
+			     &comp_len);
+	if (ret)
+		goto out;
+
+	if (comp_len >= ZRAM_MP_PAGES * huge_class_size) {
+		ret = -E2BIG;
+		goto out;
+	}
+
+	obj->comp_len = comp_len;
+	obj->nr_chunks = DIV_ROUND_UP(comp_len, PAGE_SIZE);
+	/* No slow path, the pages are stored one by one instead */
+	for (i = 0; i < obj->nr_chunks; i++) {
+		obj->handles[i] = zs_malloc(zram->mem_pool,
+					    zram_mp_chunk_len(obj, i),
+					    __GFP_KSWAPD_RECLAIM |
+					    __GFP_NOWARN |
+					    __GFP_HIGHMEM |
+					    __GFP_MOVABLE);
+		if (IS_ERR_VALUE(obj->handles[i])) {
+			ret = -ENOMEM;
+			goto out_free;
+		}
+	}
+
+	alloced_pages = zs_get_total_pages(zram->mem_pool);
+	update_used_max(zram, alloced_pages);
+
+	if (zram->limit_pages && alloced_pages > zram->limit_pages) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	for (i = 0, off = 0; i < obj->nr_chunks; i++, off += len) {
+		len = zram_mp_chunk_len(obj, i);
+		dst = zs_map_object(zram->mem_pool, obj->handles[i], ZS_MM_WO);
+		memcpy(dst, zstrm->buffer + off, len);
+		zs_unmap_object(zram->mem_pool, obj->handles[i]);
+	}
+	goto out;
+
+out_free:
+	while (i--)
+		zs_free(zram->mem_pool, obj->handles[i]);
+out:
+	zcomp_stream_put(comp);
+	vm_unmap_ram(src, ZRAM_MP_PAGES);
+	if (ret) {
+		kfree(obj);
+		return ret;
+	}
+
+	atomic64_add(comp_len, &zram->stats.compr_data_size);
+	atomic_set(&obj->refs, ZRAM_MP_PAGES);
+	for (i = 0; i < ZRAM_MP_PAGES; i++) {
+		zram_slot_lock(zram, index + i);
+		zram_free_page(zram, index + i);
+		zram_set_flag(zram, index + i, ZRAM_MULTI_PAGES);
+		zram_set_handle(zram, index + i, (unsigned long)obj);
+		zram_accessed(zram, index + i);
+		zram_slot_unlock(zram, index + i);
+	}
+	atomic64_add(ZRAM_MP_PAGES, &zram->stats.pages_stored);
+	return 0;
+}
+
+/*
+ * Stores a full, aligned unit of @bio at @iter as one object and
+ * advances @iter past it. Returns false if the pages have to be written
+ * one by one.
+ */
+static bool zram_bio_write_mp(struct zram *zram, struct bio *bio,
+			      struct bvec_iter *iter)
+{
+	u32 index = iter->bi_sector >> SECTORS_PER_PAGE_SHIFT;
+	struct page *pages[ZRAM_MP_PAGES];
+	struct bvec_iter it = *iter;
+	unsigned int i;
+
+	if (!READ_ONCE(zram->multi_pages) ||
+	    !IS_ALIGNED(iter->bi_sector, ZRAM_MP_PAGES * SECTORS_PER_PAGE) ||
+	    iter->bi_size < ZRAM_MP_PAGES * PAGE_SIZE)
+		return false;
+
+	for (i = 0; i < ZRAM_MP_PAGES; i++) {
+		struct bio_vec bv = bio_iter_iovec(bio, it);
+
+		if (bv.bv_len != PAGE_SIZE)
+			return false;
+		pages[i] = bv.bv_page;
+		bio_advance_iter_single(bio, &it, PAGE_SIZE);
+	}
+
+	if (zram_write_mp(zram, pages, index))
+		return false;
+
+	*iter = it;
+	return true;
+}
+
+/*
+ * Serves the full pages of @bio at @iter that belong to the same unit
+ * with a single decompression and advances @iter past them. Returns the
+ * number of pages read, 0 if they have to be read one by one.
+ */
+static int zram_bio_read_mp(struct zram *zram, struct bio *bio,
+			    struct bvec_iter *iter)
+{
+	u32 index = iter->bi_sector >> SECTORS_PER_PAGE_SHIFT;
+	struct page *pages[ZRAM_MP_PAGES];
+	struct zram_mp_obj *obj = NULL;
+	struct bvec_iter it = *iter;
+	struct zcomp_strm *zstrm;
+	unsigned int nr, max, i;
+	u32 off;
+	void *dst;
+	int ret;
+
+	if (!(READ_ONCE(zram->table[index].flags) & BIT(ZRAM_MULTI_PAGES)) ||
+	    !IS_ALIGNED(iter->bi_sector, SECTORS_PER_PAGE))
+		return 0;
+
+	max = ZRAM_MP_PAGES - (index & (ZRAM_MP_PAGES - 1));
+	for (nr = 0; nr < max && it.bi_size; nr++) {
+		struct bio_vec bv = bio_iter_iovec(bio, it);
+
+		if (bv.bv_len != PAGE_SIZE)
+			break;
+		pages[nr] = bv.bv_page;
+		bio_advance_iter_single(bio, &it, PAGE_SIZE);
+	}
+
+	for (i = 0; i < nr; i++) {
+		unsigned long handle;
+
+		zram_slot_lock(zram, index + i);
+		handle = zram_get_handle(zram, index + i);
+		if (!zram_test_flag(zram, index + i, ZRAM_MULTI_PAGES) ||
+		    zram_test_flag(zram, index + i, ZRAM_PENDING) ||
+		    (obj && handle != (unsigned long)obj)) {
+			zram_slot_unlock(zram, index + i);
+			break;
+		}
+		obj = (void *)handle;
+	}
+	nr = i;
+
+	/* A single page is left to the regular path */
+	if (nr < 2) {
+		while (i--)
+			zram_slot_unlock(zram, index + i);
+		return 0;
+	}
+
+	off = (index & (ZRAM_MP_PAGES - 1)) << PAGE_SHIFT;
+	zstrm = zcomp_stream_get(zram->comps[ZRAM_PRIMARY_COMP]);
+	ret = zram_mp_decompress(zram, zstrm, obj);
+	for (i = 0; !ret && i < nr; i++) {
+		dst = kmap_local_page(pages[i]);
+		memcpy(dst, zstrm->buffer + off + (i << PAGE_SHIFT), PAGE_SIZE);
+		kunmap_local(dst);
+		flush_dcache_page(pages[i]);
+	}
+	zcomp_stream_put(zram->comps[ZRAM_PRIMARY_COMP]);
+
+	for (i = 0; i < nr; i++) {
+		if (!ret)
+			zram_accessed(zram, index + i);
+		zram_slot_unlock(zram, index + i);
+	}
+
+	/* Should NEVER happen. Return bio error if it does. */
+	if (WARN_ON(ret < 0)) {
+		pr_err("Decompression failed! err=%d, page=%u\n", ret, index);
+		return ret;
+	}
+
+	bio_advance_iter(bio, iter, nr * PAGE_SIZE);
+	return nr;
+}
+#else
+static inline bool zram_bio_write_mp(struct zram *zram, struct bio *bio,
+				     struct bvec_iter *iter)
+{
+	return false;
+}
+
+static inline int zram_bio_read_mp(struct zram *zram, struct bio *bio,
+				   struct bvec_iter *iter)
+{
+	return 0;
+}
+#endif
+
 static void zram_bio_discard(struct zram *zram, struct bio *bio)
 {
 	size_t n = bio->bi_iter.bi_size;
@@ -1874,10 +2397,15 @@ static void zram_bio_read(struct zram *zram, struct bio *bio)
 		u32 offset = (iter.bi_sector & (SECTORS_PER_PAGE - 1)) <<
 				SECTOR_SHIFT;
 		struct bio_vec bv = bio_iter_iovec(bio, iter);
+		int nr;
+
+		nr = zram_bio_read_mp(zram, bio, &iter);
+		if (nr > 0)
+			continue;
 
 		bv.bv_len = min_t(u32, bv.bv_len, PAGE_SIZE - offset);
 
-		if (zram_bvec_read(zram, &bv, index, offset, bio) < 0) {
+		if (nr < 0 || zram_bvec_read(zram, &bv, index, offset, bio) < 0) {
 			atomic64_inc(&zram->stats.failed_reads);
 			bio->bi_status = BLK_STS_IOERR;
 			break;
@@ -1895,9 +2423,8 @@ static void zram_bio_read(struct zram *zram, struct bio *bio)
 	bio_endio(bio);
 }
 
-static void zram_bio_write(struct zram *zram, struct bio *bio)
+static void __zram_bio_write(struct zram *zram, struct bio *bio)
 {
-	unsigned long start_time = bio_start_io_acct(bio);
 	struct bvec_iter iter = bio->bi_iter;
 
 	do {
@@ -1906,6 +2433,9 @@ static void zram_bio_write(struct zram *zram, struct bio *bio)
 				SECTOR_SHIFT;
 		struct bio_vec bv = bio_iter_iovec(bio, iter);
 
+		if (zram_bio_write_mp(zram, bio, &iter))
+			continue;
+
 		bv.bv_len = min_t(u32, bv.bv_len, PAGE_SIZE - offset);
 
 		if (zram_bvec_write(zram, &bv, index, offset, bio) < 0) {
@@ -1920,11 +2450,152 @@ static void zram_bio_write(struct zram *zram, struct bio *bio)
 
 		bio_advance_iter_single(bio, &iter, bv.bv_len);
 	} while (iter.bi_size);
+}
+
+static void zram_bio_write(struct zram *zram, struct bio *bio)
+{
+	unsigned long start_time = bio_start_io_acct(bio);
+
+	__zram_bio_write(zram, bio);
 
 	bio_end_io_acct(bio, start_time);
 	bio_endio(bio);
 }
 
+/* Max number of bios a write worker takes off the queue at once */
+#define ZRAM_WR_BATCH	32
+
+static void zram_clear_pending(struct zram *zram, struct bio *bio)
+{
+	struct bvec_iter iter;
+	struct bio_vec bv;
+
+	bio_for_each_segment(bv, bio, iter) {
+		u32 index = iter.bi_sector >> SECTORS_PER_PAGE_SHIFT;
+
+		zram_slot_lock(zram, index);
+		zram_clear_flag(zram, index, ZRAM_PENDING);
+		zram_slot_unlock(zram, index);
+	}
+	wake_up_all(&zram->wr_wait);
+}
+
+static void zram_wr_work(struct work_struct *work)
+{
+	struct zram_wr_worker *worker =
+		container_of(work, struct zram_wr_worker, work);
+	struct zram *zram = worker->zram;
+	struct bio_list batch;
+	struct bio *bio;
+	int n;
+
+	for (;;) {
+		bio_list_init(&batch);
+		spin_lock_irq(&zram->wr_lock);
+		for (n = 0; n < ZRAM_WR_BATCH; n++) {
+			bio = bio_list_pop(&zram->wr_bios);
+			if (!bio)
+				break;
+			bio_list_add(&batch, bio);
+		}
+		spin_unlock_irq(&zram->wr_lock);
+
+		if (bio_list_empty(&batch))
+			break;
+
+		while ((bio = bio_list_pop(&batch))) {
+			unsigned long start_time = bio_start_io_acct(bio);
+
+			__zram_bio_write(zram, bio);
+			/* also for pages left unwritten after an error */
+			zram_clear_pending(zram, bio);
+
+			bio_end_io_acct(bio, start_time);
+			bio_endio(bio);
+		}
+		cond_resched();
+	}
+}
+
+/*
+ * Queue a write bio to the compression workers. Only bios made of full
+ * pages are queued, a partial write would have to read the slot it is
+ * itself about to write. Returns false if the bio must be written
+ * synchronously.
+ */
+static bool zram_bio_write_async(struct zram *zram, struct bio *bio)
+{
+	struct bvec_iter iter;
+	struct bio_vec bv;
+	unsigned long flags;
+	unsigned int i;
+
+	if (!zram->wr_wq ||
+	    !IS_ALIGNED(bio->bi_iter.bi_sector, SECTORS_PER_PAGE))
+		return false;
+
+	bio_for_each_segment(bv, bio, iter) {
+		if (bv.bv_len != PAGE_SIZE)
+			return false;
+	}
+
+	/* Reads of these slots wait until the data is stored */
+	bio_for_each_segment(bv, bio, iter) {
+		u32 index = iter.bi_sector >> SECTORS_PER_PAGE_SHIFT;
+
+		zram_slot_lock(zram, index);
+		zram_set_flag(zram, index, ZRAM_PENDING);
+		zram_slot_unlock(zram, index);
+	}
+
+	spin_lock_irqsave(&zram->wr_lock, flags);
+	bio_list_add(&zram->wr_bios, bio);
+	spin_unlock_irqrestore(&zram->wr_lock, flags);
+
+	/* Spread the queue over the workers, an already queued one batches */
+	i = (unsigned int)atomic_inc_return(&zram->wr_next) %
+		zram->nr_wr_workers;
+	queue_work(zram->wr_wq, &zram->wr_workers[i].work);
+	return true;
+}
+
+static int zram_wr_init(struct zram *zram)
+{
+	unsigned int i;
+
+	zram->nr_wr_workers = num_online_cpus();
+	zram->wr_workers = kcalloc(zram->nr_wr_workers,
+				   sizeof(*zram->wr_workers), GFP_KERNEL);
+	if (!zram->wr_workers)
+		return -ENOMEM;
+
+	zram->wr_wq = alloc_workqueue("%s_wr", WQ_UNBOUND | WQ_MEM_RECLAIM |
+				      WQ_HIGHPRI, 0, zram->disk->disk_name);
+	if (!zram->wr_wq) {
+		kfree(zram->wr_workers);
+		zram->wr_workers = NULL;
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < zram->nr_wr_workers; i++) {
+		INIT_WORK(&zram->wr_workers[i].work, zram_wr_work);
+		zram->wr_workers[i].zram = zram;
+	}
+	return 0;
+}
+
+static void zram_wr_destroy(struct zram *zram)
+{
+	if (!zram->wr_wq)
+		return;
+
+	destroy_workqueue(zram->wr_wq);
+	zram->wr_wq = NULL;
+	kfree(zram->wr_workers);
+	zram->wr_workers = NULL;
+	zram->nr_wr_workers = 0;
+}
+
 /*
  * Handler function for all zram I/O requests.
  */
@@ -1937,7 +2608,8 @@ static void zram_submit_bio(struct bio *bio)
 		zram_bio_read(zram, bio);
 		break;
 	case REQ_OP_WRITE:
-		zram_bio_write(zram, bio);
+		if (!zram_bio_write_async(zram, bio))
+			zram_bio_write(zram, bio);
 		break;
 	case REQ_OP_DISCARD:
 	case REQ_OP_WRITE_ZEROES:
@@ -1995,6 +2667,9 @@ static void zram_reset_device(struct zram *zram)
 	set_capacity_and_notify(zram->disk, 0);
 	part_stat_set_all(zram->disk->part0, 0);
 
+	/* Drains the queued async writes */
+	zram_wr_destroy(zram);
+
 	/* I/O operation under all of CPU are done so let's free */
 	zram_meta_free(zram, zram->disksize);
 	zram->disksize = 0;
@@ -2036,7 +2711,8 @@ static ssize_t disksize_store(struct device *dev,
 		if (!zram->comp_algs[prio])
 			continue;
 
-		comp = zcomp_create(zram->comp_algs[prio]);
+		comp = zcomp_create(zram->comp_algs[prio],
+				    &zram->params[prio]);
 		if (IS_ERR(comp)) {
 			pr_err("Cannot initialise %s compressing backend\n",
 			       zram->comp_algs[prio]);
@@ -2047,6 +2723,13 @@ static ssize_t disksize_store(struct device *dev,
 		zram->comps[prio] = comp;
 		zram->num_active_comps++;
 	}
+
+	if (zram->async_write) {
+		err = zram_wr_init(zram);
+		if (err)
+			goto out_free_comps;
+	}
+
 	zram->disksize = disksize;
 	set_capacity_and_notify(zram->disk, zram->disksize >> SECTOR_SHIFT);
 	up_write(&zram->init_lock);
@@ -2128,7 +2811,14 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
+static DEVICE_ATTR_RW(async_write);
+#ifdef CONFIG_ZRAM_MULTI_PAGES
+static DEVICE_ATTR_RW(multi_pages);
+#endif
 static DEVICE_ATTR_RW(comp_algorithm);
+#ifdef CONFIG_ZRAM_ALGORITHM_PARAMS
+static DEVICE_ATTR_WO(algorithm_params);
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
@@ -2149,7 +2839,14 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
+	&dev_attr_async_write.attr,
+#ifdef CONFIG_ZRAM_MULTI_PAGES
+	&dev_attr_multi_pages.attr,
+#endif
 	&dev_attr_comp_algorithm.attr,
+#ifdef CONFIG_ZRAM_ALGORITHM_PARAMS
+	&dev_attr_algorithm_params.attr,
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 	&dev_attr_writeback.attr,
@@ -2193,6 +2890,9 @@ static int zram_add(void)
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spin_lock_init(&zram->wb_limit_lock);
 #endif
+	spin_lock_init(&zram->wr_lock);
+	bio_list_init(&zram->wr_bios);
+	init_waitqueue_head(&zram->wr_wait);
 
 	/* gendisk structure */
 	zram->disk = blk_alloc_disk(NUMA_NO_NODE);
@@ -2262,6 +2962,7 @@ out_free_dev:
 static int zram_remove(struct zram *zram)
 {
 	bool claimed;
+	u32 prio;
 
 	mutex_lock(&zram->disk->open_mutex);
 	if (disk_openers(zram->disk)) {
@@ -2302,6 +3003,9 @@ static int zram_remove(struct zram *zram)
 	 */
 	zram_reset_device(zram);
 
+	for (prio = 0; prio < ZRAM_MAX_COMPS; prio++)
+		comp_params_reset(zram, prio);
+
 	put_disk(zram->disk);
 	kfree(zram);
 	return 0;
@@ -18,6 +18,8 @@
 #include <linux/rwsem.h>
 #include <linux/zsmalloc.h>
 #include <linux/crypto.h>
+#include <linux/bio.h>
+#include <linux/workqueue.h>
 
 #include "zcomp.h"
 
@@ -53,6 +55,8 @@ enum zram_pageflags {
 	ZRAM_HUGE,	/* Incompressible page */
 	ZRAM_IDLE,	/* not accessed page since last idle marking */
 	ZRAM_INCOMPRESSIBLE, /* none of the algorithms could compress it */
+	ZRAM_PENDING,	/* async write queued, data not stored yet */
+	ZRAM_MULTI_PAGES, /* page is part of a multi-page unit */
 
 	ZRAM_COMP_PRIORITY_BIT1, /* First bit of comp priority index */
 	ZRAM_COMP_PRIORITY_BIT2, /* Second bit of comp priority index */
@@ -103,6 +107,30 @@ struct zram_stats {
 #define ZRAM_MAX_COMPS	1U
 #endif
 
+#ifdef CONFIG_ZRAM_MULTI_PAGES
+#define ZRAM_MP_PAGES	(1U << CONFIG_ZRAM_MULTI_PAGES_ORDER)
+
+/*
+ * ZRAM_MP_PAGES contiguous pages compressed as one stream. zsmalloc
+ * objects are at most a page, so the stream is stored in chunks. Every
+ * slot of the unit holds a reference and points to it with its handle,
+ * a slot can be overwritten or freed without touching the others.
+ */
+struct zram_mp_obj {
+	/* never reused, tags the unit decompressed in a zcomp_strm */
+	u64 id;
+	atomic_t refs;
+	unsigned int comp_len;
+	unsigned int nr_chunks;
+	unsigned long handles[ZRAM_MP_PAGES];
+};
+#endif
+
+struct zram_wr_worker {
+	struct work_struct work;
+	struct zram *zram;
+};
+
 struct zram {
 	struct zram_table_entry *table;
 	struct zs_pool *mem_pool;
@@ -122,11 +150,27 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	const char *comp_algs[ZRAM_MAX_COMPS];
+	struct zcomp_params params[ZRAM_MAX_COMPS];
 	s8 num_active_comps;
 	/*
 	 * zram is claimed so open request will be failed
 	 */
 	bool claim; /* Protected by disk->open_mutex */
+	/* compress aligned runs of ZRAM_MP_PAGES pages as one unit */
+	bool multi_pages;
+	atomic64_t mp_next_id;
+	/*
+	 * Async write mode: write bios are compressed by a pool of
+	 * workers instead of the submitter.
+	 */
+	bool async_write;
+	struct workqueue_struct *wr_wq;
+	struct zram_wr_worker *wr_workers;
+	unsigned int nr_wr_workers;
+	atomic_t wr_next;
+	spinlock_t wr_lock;
+	struct bio_list wr_bios;
+	wait_queue_head_t wr_wait;
 #ifdef CONFIG_ZRAM_WRITEBACK
 	struct file *backing_dev;
 	spinlock_t wb_limit_lock;
@@ -471,19 +471,20 @@ static CLOSURE_CALLBACK(read_dirty_submit)
 	continue_at(cl, write_dirty, io->dc->writeback_write_wq);
 }
 
-static void read_dirty(struct cached_dev *dc)
+/*
+ * Start writeback of the keys in dc->writeback_keys.  The IOs stay in flight
+ * when this returns, so the next refill overlaps with them instead of the
+ * pipeline draining for every keybuf worth of keys; @cl is the parent of
+ * all of them and @sequence orders the writes across calls.
+ */
+static void read_dirty(struct cached_dev *dc, struct closure *cl,
+		       uint16_t *sequence)
 {
 	unsigned int delay = 0;
 	struct keybuf_key *next, *keys[MAX_WRITEBACKS_IN_PASS], *w;
 	size_t size;
 	int nk, i;
 	struct dirty_io *io;
-	struct closure cl;
-	uint16_t sequence = 0;
-
-	BUG_ON(!llist_empty(&dc->writeback_ordering_wait.list));
-	atomic_set(&dc->writeback_sequence_next, sequence);
-	closure_init_stack(&cl);
 
 	/*
 	 * XXX: if we error, background writeback just spins. Should use some
@@ -516,17 +517,11 @@ static void read_dirty(struct cached_dev *dc)
 				break;
 
 			/*
-			 * Operations are only eligible to be combined
-			 * if they are contiguous.
-			 *
-			 * TODO: add a heuristic willing to fire a
-			 * certain amount of non-contiguous IO per pass,
-			 * so that we can benefit from backing device
-			 * command queueing.
+			 * Operations don't need to be contiguous to be
+			 * combined: the keybuf is sorted, so the writes of
+			 * a pass still go out in ascending order and the
+			 * backing device can queue and merge them.
 			 */
-			if ((nk != 0) && bkey_cmp(&keys[nk-1]->key,
-						&START_KEY(&next->key)))
-				break;
 
 			size += KEY_SIZE(&next->key);
 			keys[nk++] = next;
@@ -544,7 +539,6 @@ static void read_dirty(struct cached_dev *dc)
 
 			w->private	= io;
 			io->dc		= dc;
-			io->sequence    = sequence++;
 
 			dirty_init(w);
 			io->bio.bi_opf = REQ_OP_READ;
@@ -555,6 +549,12 @@ static void read_dirty(struct cached_dev *dc)
 			if (bch_bio_alloc_pages(&io->bio, GFP_KERNEL))
 				goto err_free;
 
+			/*
+			 * Only now that the write is certain to be issued, as
+			 * write_dirty() waits for every earlier sequence.
+			 */
+			io->sequence    = (*sequence)++;
+
 			trace_bcache_writeback(&w->key);
 
 			down(&dc->in_flight);
@@ -564,7 +564,7 @@ static void read_dirty(struct cached_dev *dc)
 			 * simultaneous number of writebacks; from here
 			 * everything happens asynchronously.
 			 */
-			closure_call(&io->cl, read_dirty_submit, NULL, &cl);
+			closure_call(&io->cl, read_dirty_submit, NULL, cl);
 		}
 
 		delay = writeback_delay(dc, size);
@@ -583,12 +583,6 @@ err_free:
 err:
 		bch_keybuf_del(&dc->writeback_keys, w);
 	}
-
-	/*
-	 * Wait for outstanding writeback IOs to finish (and keybuf slots to be
-	 * freed) before refilling again
-	 */
-	closure_sync(&cl);
 }
 
 /* Scan for dirty data */
@@ -741,6 +735,12 @@ static int bch_writeback_thread(void *arg)
 	struct cached_dev *dc = arg;
 	struct cache_set *c = dc->disk.c;
 	bool searched_full_index;
+	struct closure cl;
+	uint16_t sequence = 0;
+
+	BUG_ON(!llist_empty(&dc->writeback_ordering_wait.list));
+	atomic_set(&dc->writeback_sequence_next, sequence);
+	closure_init_stack(&cl);
 
 	bch_ratelimit_reset(&dc->writeback_rate);
 
@@ -784,14 +784,14 @@ static int bch_writeback_thread(void *arg)
 			 * bch_cached_dev_detach().
 			 */
 			if (test_bit(BCACHE_DEV_DETACHING, &dc->disk.flags)) {
-				struct closure cl;
+				struct closure sb_cl;
 
-				closure_init_stack(&cl);
+				closure_init_stack(&sb_cl);
 				memset(&dc->sb.set_uuid, 0, 16);
 				SET_BDEV_STATE(&dc->sb, BDEV_STATE_NONE);
 
-				bch_write_bdev_super(dc, &cl);
-				closure_sync(&cl);
+				bch_write_bdev_super(dc, &sb_cl);
+				closure_sync(&sb_cl);
 
 				up_write(&dc->writeback_lock);
 				break;
@@ -817,11 +817,17 @@ static int bch_writeback_thread(void *arg)
 
 		up_write(&dc->writeback_lock);
 
-		read_dirty(dc);
+		read_dirty(dc, &cl, &sequence);
 
 		if (searched_full_index) {
 			unsigned int delay = dc->writeback_delay * HZ;
 
+			/*
+			 * Let the last keys finish, so the next pass finds
+			 * the index clean if nothing was dirtied meanwhile.
+			 */
+			closure_sync(&cl);
+
 			while (delay &&
 			       !kthread_should_stop() &&
 			       !test_bit(CACHE_SET_IO_DISABLE, &c->flags) &&
@@ -832,6 +838,9 @@ static int bch_writeback_thread(void *arg)
 		}
 	}
 
+	/* Wait for outstanding writeback IOs before tearing down their wq */
+	closure_sync(&cl);
+
 	if (dc->writeback_write_wq)
 		destroy_workqueue(dc->writeback_write_wq);
 
@@ -1047,7 +1056,7 @@ out:
 
 void bch_cached_dev_writeback_init(struct cached_dev *dc)
 {
-	sema_init(&dc->in_flight, 64);
+	sema_init(&dc->in_flight, MAX_WRITEBACKS_IN_FLIGHT);
 	init_rwsem(&dc->writeback_lock);
 	bch_keybuf_init(&dc->writeback_keys);
 
@@ -1075,6 +1084,14 @@ void bch_cached_dev_writeback_init(struct cached_dev *dc)
 
 int bch_cached_dev_writeback_start(struct cached_dev *dc)
 {
+	/*
+	 * Reading dirty data back is cheap on a non-rotational cache, keep
+	 * more of it in flight so a slow backing device always has a deep,
+	 * sorted queue of writes.
+	 */
+	sema_init(&dc->in_flight, bdev_nonrot(dc->disk.c->cache->bdev) ?
+		  MAX_WRITEBACKS_IN_FLIGHT_NONROT : MAX_WRITEBACKS_IN_FLIGHT);
+
 	dc->writeback_write_wq = alloc_workqueue("bcache_writeback_wq",
 						WQ_MEM_RECLAIM, 0);
 	if (!dc->writeback_write_wq)
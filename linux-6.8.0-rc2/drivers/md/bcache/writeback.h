@@ -11,6 +11,10 @@
 #define MAX_WRITEBACKS_IN_PASS  5
 #define MAX_WRITESIZE_IN_PASS   5000	/* *512b */
 
+/* Dirty keys being read/written at once, must stay below KEYBUF_NR */
+#define MAX_WRITEBACKS_IN_FLIGHT		64
+#define MAX_WRITEBACKS_IN_FLIGHT_NONROT		256
+
 #define WRITEBACK_RATE_UPDATE_SECS_MAX		60
 #define WRITEBACK_RATE_UPDATE_SECS_DEFAULT	5
 
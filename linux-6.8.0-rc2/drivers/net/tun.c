@@ -69,6 +69,8 @@
 #include <linux/bpf.h>
 #include <linux/bpf_trace.h>
 #include <linux/mutex.h>
+#include <linux/sizes.h>
+#include <linux/vmalloc.h>
 #include <linux/ieee802154.h>
 #include <linux/if_ltalk.h>
 #include <uapi/linux/if_fddi.h>
@@ -145,6 +147,36 @@ struct tun_file {
 	struct tun_struct *detached;
 	struct ptr_ring tx_ring;
 	struct xdp_rxq_info xdp_rxq;
+	struct tun_shm *shm;
+};
+
+/* Shared-memory packet rings set up by TUNSETRING. The whole area is
+ * vmalloc'ed in one piece, charged to the caller's memcg, and mapped
+ * into user space as is.
+ */
+#define TUN_SHM_MAX_DESCS	4096
+#define TUN_SHM_MIN_FRAME	256
+#define TUN_SHM_MAX_FRAME	SZ_128K
+#define TUN_SHM_MAX_SIZE	SZ_64M
+#define TUN_SHM_BATCH		32
+
+struct tun_shm_ring {
+	u32 producer ____cacheline_aligned_in_smp;
+	u32 consumer ____cacheline_aligned_in_smp;
+	struct tun_ring_desc desc[] ____cacheline_aligned_in_smp;
+};
+
+struct tun_shm {
+	void *area;
+	size_t size;
+	u32 mask;
+	u32 frame_size;
+	struct tun_shm_ring *rx;
+	struct tun_shm_ring *tx;
+	void *rx_frames;
+	void *tx_frames;
+	struct mutex rx_mutex;	/* Serializes producers of the rx ring */
+	struct mutex tx_mutex;	/* Serializes consumers of the tx ring */
 };
 
 struct tun_page {
@@ -632,6 +664,18 @@ static void tun_queue_purge(struct tun_file *tfile)
 	skb_queue_purge(&tfile->sk.sk_error_queue);
 }
 
+static void tun_shm_free(struct tun_file *tfile)
+{
+	struct tun_shm *shm = tfile->shm;
+
+	if (!shm)
+		return;
+
+	tfile->shm = NULL;
+	vfree(shm->area);
+	kfree(shm);
+}
+
 static void __tun_detach(struct tun_file *tfile, bool clean)
 {
 	struct tun_file *ntfile;
@@ -686,6 +730,7 @@ static void __tun_detach(struct tun_file *tfile, bool clean)
 		if (tun)
 			xdp_rxq_info_unreg(&tfile->xdp_rxq);
 		ptr_ring_cleanup(&tfile->tx_ring, tun_ptr_free);
+		tun_shm_free(tfile);
 	}
 }
 
@@ -2037,12 +2082,64 @@ unlock_frags:
 	return err ?: total_len;
 }
 
+/* Send the packets queued in the shared tx ring. Returns the number of
+ * descriptors consumed.
+ */
+static ssize_t tun_shm_tx(struct tun_struct *tun, struct tun_file *tfile,
+			  struct tun_shm *shm, int noblock)
+{
+	struct tun_shm_ring *ring = shm->tx;
+	u32 cons, prod, n = 0;
+	ssize_t ret = 0;
+
+	mutex_lock(&shm->tx_mutex);
+
+	cons = ring->consumer;
+	prod = smp_load_acquire(&ring->producer);
+	if (unlikely(prod - cons > shm->mask + 1)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	while (cons != prod) {
+		struct tun_ring_desc *desc = &ring->desc[cons & shm->mask];
+		u32 len = READ_ONCE(desc->len);
+		struct iov_iter from;
+		struct kvec iov;
+
+		if (unlikely(len > shm->frame_size)) {
+			dev_core_stats_rx_dropped_inc(tun->dev);
+			goto next;
+		}
+
+		iov.iov_base = shm->tx_frames +
+			       (size_t)(cons & shm->mask) * shm->frame_size;
+		iov.iov_len = len;
+		iov_iter_kvec(&from, ITER_SOURCE, &iov, 1, len);
+
+		ret = tun_get_user(tun, tfile, NULL, &from, noblock,
+				   cons + 1 != prod);
+		if (ret == -EAGAIN)
+			break;
+next:
+		cons++;
+		n++;
+	}
+
+	smp_store_release(&ring->consumer, cons);
+	ret = n ? n : min_t(ssize_t, ret, 0);
+out:
+	mutex_unlock(&shm->tx_mutex);
+	return ret;
+}
+
 static ssize_t tun_chr_write_iter(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct file *file = iocb->ki_filp;
 	struct tun_file *tfile = file->private_data;
 	struct tun_struct *tun = tun_get(tfile);
 	ssize_t result;
+	struct tun_shm *shm;
 	int noblock = 0;
 
 	if (!tun)
@@ -2051,7 +2148,12 @@ static ssize_t tun_chr_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	if ((file->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT))
 		noblock = 1;
 
-	result = tun_get_user(tun, tfile, NULL, from, noblock, false);
+	/* pairs with smp_store_release() in tun_shm_setup() */
+	shm = smp_load_acquire(&tfile->shm);
+	if (shm)
+		result = tun_shm_tx(tun, tfile, shm, noblock);
+	else
+		result = tun_get_user(tun, tfile, NULL, from, noblock, false);
 
 	tun_put(tun);
 	return result;
@@ -2256,12 +2358,83 @@ static ssize_t tun_do_read(struct tun_struct *tun, struct tun_file *tfile,
 	return ret;
 }
 
+/* Move pending packets into the shared rx ring, waiting for the first one
+ * unless @noblock. Returns the number of descriptors produced.
+ */
+static ssize_t tun_shm_rx(struct tun_struct *tun, struct tun_file *tfile,
+			  struct tun_shm *shm, int noblock)
+{
+	struct tun_shm_ring *ring = shm->rx;
+	void *ptrs[TUN_SHM_BATCH];
+	u32 prod, space, n = 0;
+	int i, batch, err = 0;
+
+	mutex_lock(&shm->rx_mutex);
+
+	prod = ring->producer;
+	space = shm->mask + 1 - (prod - smp_load_acquire(&ring->consumer));
+	if (unlikely(space > shm->mask + 1)) {
+		err = -EINVAL;
+		goto out;
+	}
+	if (!space) {
+		err = -ENOBUFS;
+		goto out;
+	}
+
+	while (n < space) {
+		batch = ptr_ring_consume_batched(&tfile->tx_ring, ptrs,
+						 min_t(u32, space - n,
+						       TUN_SHM_BATCH));
+		if (!batch) {
+			if (n || noblock)
+				break;
+			/* Nothing pending yet, wait for the first packet */
+			ptrs[0] = tun_ring_recv(tfile, noblock, &err);
+			if (!ptrs[0])
+				break;
+			batch = 1;
+		}
+
+		for (i = 0; i < batch; i++) {
+			struct tun_ring_desc *desc = &ring->desc[prod & shm->mask];
+			struct iov_iter to;
+			struct kvec iov;
+			ssize_t ret;
+
+			iov.iov_base = shm->rx_frames +
+				       (size_t)(prod & shm->mask) * shm->frame_size;
+			iov.iov_len = shm->frame_size;
+			iov_iter_kvec(&to, ITER_DEST, &iov, 1, shm->frame_size);
+
+			ret = tun_do_read(tun, tfile, &to, noblock, ptrs[i]);
+			if (unlikely(ret < 0))
+				continue;
+
+			desc->len = min_t(size_t, ret, shm->frame_size);
+			desc->flags = ret > shm->frame_size ?
+				      TUN_RING_DESC_TRUNC : 0;
+			prod++;
+			n++;
+		}
+	}
+
+	/* Publish the whole batch at once */
+	smp_store_release(&ring->producer, prod);
+	if (!n && noblock)
+		err = -EAGAIN;
+out:
+	mutex_unlock(&shm->rx_mutex);
+	return n ?: err;
+}
+
 static ssize_t tun_chr_read_iter(struct kiocb *iocb, struct iov_iter *to)
 {
 	struct file *file = iocb->ki_filp;
 	struct tun_file *tfile = file->private_data;
 	struct tun_struct *tun = tun_get(tfile);
 	ssize_t len = iov_iter_count(to), ret;
+	struct tun_shm *shm;
 	int noblock = 0;
 
 	if (!tun)
@@ -2270,6 +2443,14 @@ static ssize_t tun_chr_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	if ((file->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT))
 		noblock = 1;
 
+	/* pairs with smp_store_release() in tun_shm_setup() */
+	shm = smp_load_acquire(&tfile->shm);
+	if (shm) {
+		ret = tun_shm_rx(tun, tfile, shm, noblock);
+		tun_put(tun);
+		return ret;
+	}
+
 	ret = tun_do_read(tun, tfile, to, noblock, NULL);
 	ret = min_t(ssize_t, ret, len);
 	if (ret > 0)
@@ -3072,6 +3253,74 @@ static unsigned char tun_get_addr_len(unsigned short type)
 	}
 }
 
+static int tun_shm_setup(struct tun_file *tfile, void __user *argp)
+{
+	size_t ring_size, frames_size, size;
+	struct tun_ring_req req;
+	struct tun_shm *shm;
+
+	if (tfile->shm)
+		return -EBUSY;
+
+	if (copy_from_user(&req, argp, sizeof(req)))
+		return -EFAULT;
+
+	if (!is_power_of_2(req.nr_descs) ||
+	    req.nr_descs > TUN_SHM_MAX_DESCS ||
+	    req.frame_size < TUN_SHM_MIN_FRAME ||
+	    req.frame_size > TUN_SHM_MAX_FRAME)
+		return -EINVAL;
+
+	ring_size = PAGE_ALIGN(struct_size_t(struct tun_shm_ring, desc,
+					     req.nr_descs));
+	frames_size = PAGE_ALIGN((size_t)req.nr_descs * req.frame_size);
+	size = 2 * (ring_size + frames_size);
+	if (size > TUN_SHM_MAX_SIZE)
+		return -EINVAL;
+
+	shm = kzalloc(sizeof(*shm), GFP_KERNEL);
+	if (!shm)
+		return -ENOMEM;
+
+	shm->area = __vmalloc(size, GFP_KERNEL_ACCOUNT | __GFP_ZERO);
+	if (!shm->area) {
+		kfree(shm);
+		return -ENOMEM;
+	}
+
+	shm->size = size;
+	shm->mask = req.nr_descs - 1;
+	shm->frame_size = req.frame_size;
+	shm->rx = shm->area;
+	shm->tx = shm->area + ring_size;
+	shm->rx_frames = shm->area + 2 * ring_size;
+	shm->tx_frames = shm->rx_frames + frames_size;
+	mutex_init(&shm->rx_mutex);
+	mutex_init(&shm->tx_mutex);
+
+	req.mmap_size = size;
+	req.rx.producer = offsetof(struct tun_shm_ring, producer);
+	req.rx.consumer = offsetof(struct tun_shm_ring, consumer);
+	req.rx.desc = offsetof(struct tun_shm_ring, desc);
+	req.rx.frames = 2 * ring_size;
+	req.tx.producer = ring_size + req.rx.producer;
+	req.tx.consumer = ring_size + req.rx.consumer;
+	req.tx.desc = ring_size + req.rx.desc;
+	req.tx.frames = req.rx.frames + frames_size;
+
+	if (copy_to_user(argp, &req, sizeof(req))) {
+		vfree(shm->area);
+		kfree(shm);
+		return -EFAULT;
+	}
+
+	/* Switches read() and write() over to the rings, publishing the
+	 * fields set up above to them.
+	 */
+	smp_store_release(&tfile->shm, shm);
+	return 0;
+}
+
 static long __tun_chr_ioctl(struct file *file, unsigned int cmd,
 			    unsigned long arg, int ifreq_len)
 {
@@ -3391,6 +3640,10 @@ static long __tun_chr_ioctl(struct file *file, unsigned int cmd,
 		ret = open_related_ns(&net->ns, get_net_ns);
 		break;
 
+	case TUNSETRING:
+		ret = tun_shm_setup(tfile, argp);
+		break;
+
 	default:
 		ret = -EINVAL;
 		break;
@@ -3424,6 +3677,7 @@ static long tun_chr_compat_ioctl(struct file *file,
 	case TUNSETSNDBUF:
 	case SIOCGIFHWADDR:
 	case SIOCSIFHWADDR:
+	case TUNSETRING:
 		arg = (unsigned long)compat_ptr(arg);
 		break;
 	default:
@@ -3441,6 +3695,35 @@ static long tun_chr_compat_ioctl(struct file *file,
 }
 #endif /* CONFIG_COMPAT */
 
+static int tun_chr_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct tun_file *tfile = file->private_data;
+	struct tun_shm *shm = smp_load_acquire(&tfile->shm);
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned long off, addr;
+	int ret;
+
+	if (!shm)
+		return -EINVAL;
+
+	/* The area is not VM_USERMAP, vmalloc_user() cannot charge a memcg,
+	 * so insert its pages here instead of using remap_vmalloc_range().
+	 */
+	off = vma->vm_pgoff << PAGE_SHIFT;
+	if (vma->vm_pgoff > shm->size >> PAGE_SHIFT ||
+	    size > shm->size - off)
+		return -EINVAL;
+
+	for (addr = 0; addr < size; addr += PAGE_SIZE) {
+		ret = vm_insert_page(vma, vma->vm_start + addr,
+				     vmalloc_to_page(shm->area + off + addr));
+		if (ret)
+			return ret;
+	}
+	vm_flags_set(vma, VM_DONTEXPAND | VM_DONTDUMP);
+	return 0;
+}
+
 static int tun_chr_fasync(int fd, struct file *file, int on)
 {
 	struct tun_file *tfile = file->private_data;
@@ -3477,6 +3760,7 @@ static int tun_chr_open(struct inode *inode, struct file * file)
 	RCU_INIT_POINTER(tfile->tun, NULL);
 	tfile->flags = 0;
 	tfile->ifindex = 0;
+	tfile->shm = NULL;
 
 	init_waitqueue_head(&tfile->socket.wq.wait);
 
@@ -3535,6 +3819,7 @@ static const struct file_operations tun_fops = {
 	.read_iter  = tun_chr_read_iter,
 	.write_iter = tun_chr_write_iter,
 	.poll	= tun_chr_poll,
+	.mmap	= tun_chr_mmap,
 	.unlocked_ioctl	= tun_chr_ioctl,
 #ifdef CONFIG_COMPAT
 	.compat_ioctl = tun_chr_compat_ioctl,
@@ -19,6 +19,7 @@
 #include <net/dst.h>
 #include <net/xfrm.h>
 #include <net/xdp.h>
+#include <net/xdp_sock_drv.h>
 #include <linux/veth.h>
 #include <linux/module.h>
 #include <linux/bpf.h>
@@ -67,6 +68,8 @@ struct veth_rq {
 	struct ptr_ring		xdp_ring;
 	struct xdp_rxq_info	xdp_rxq;
 	struct page_pool	*page_pool;
+	struct xsk_buff_pool __rcu *xsk_pool;
+	struct xdp_rxq_info	xsk_rxq;
 };
 
 struct veth_priv {
@@ -939,10 +942,167 @@ xdp_xmit:
 	return NULL;
 }
 
+/* @orig is the skb the packet came in as, if any, to carry its metadata over */
+static struct sk_buff *veth_xsk_build_skb(struct veth_rq *rq,
+					  struct xdp_buff *xdp,
+					  const struct sk_buff *orig)
+{
+	unsigned int metasize = xdp->data - xdp->data_meta;
+	unsigned int totalsize = xdp->data_end - xdp->data_meta;
+	struct sk_buff *skb;
+
+	skb = napi_alloc_skb(&rq->xdp_napi, totalsize);
+	if (likely(skb)) {
+		skb_put_data(skb, xdp->data_meta, totalsize);
+		if (metasize) {
+			__skb_pull(skb, metasize);
+			skb_metadata_set(skb, metasize);
+		}
+		skb->protocol = eth_type_trans(skb, rq->dev);
+
+		if (orig) {
+			/* as veth_xdp_rcv_skb() would have kept them */
+			if (orig->ip_summed == CHECKSUM_UNNECESSARY) {
+				skb->ip_summed = CHECKSUM_UNNECESSARY;
+				skb->csum_level = orig->csum_level;
+			}
+			skb_copy_hash(skb, orig);
+			skb->mark = orig->mark;
+			skb->priority = orig->priority;
+			skb->tstamp = orig->tstamp;
+		}
+	}
+
+	xsk_buff_free(xdp);
+	return skb;
+}
+
+/* With an AF_XDP zero-copy pool bound to the queue, packets coming from the
+ * peer are copied straight into a UMEM frame and the program runs on that, so
+ * XDP_REDIRECT into the socket needs no further copy.
+ *
+ * Returns false if the packet doesn't fit a UMEM frame and must take the
+ * regular path instead; otherwise it has been consumed.
+ */
+static bool veth_xsk_rcv_one(struct veth_rq *rq, void *ptr,
+			     struct veth_xdp_tx_bq *bq,
+			     struct veth_stats *stats)
+{
+	struct xdp_frame *frame = NULL;
+	struct xsk_buff_pool *pool;
+	struct bpf_prog *xdp_prog;
+	struct sk_buff *skb = NULL;
+	struct xdp_buff *xdp;
+	u32 act, len;
+
+	rcu_read_lock();
+	pool = rcu_dereference(rq->xsk_pool);
+	xdp_prog = rcu_dereference(rq->xdp_prog);
+	if (unlikely(!pool || !xdp_prog))
+		goto out_fallback;
+
+	if (veth_is_xdp_frame(ptr)) {
+		frame = veth_ptr_to_xdp(ptr);
+		if (xdp_frame_has_frags(frame) ||
+		    frame->len > xsk_pool_get_rx_frame_size(pool))
+			goto out_fallback;
+		len = frame->len;
+		stats->xdp_bytes += len;
+	} else {
+		skb = ptr;
+		/*
+		 * A copy in the UMEM frame can't keep csum_start/csum_offset
+		 * for XDP_PASS, let such skbs take the regular skb path.
+		 */
+		if (skb->ip_summed == CHECKSUM_PARTIAL ||
+		    skb->len + (skb->data - skb_mac_header(skb)) >
+		    xsk_pool_get_rx_frame_size(pool))
+			goto out_fallback;
+		stats->xdp_bytes += skb->len;
+		__skb_push(skb, skb->data - skb_mac_header(skb));
+		len = skb->len;
+	}
+
+	xdp = xsk_buff_alloc(pool);
+	if (unlikely(!xdp)) {
+		/* Fill ring is empty: drop, as a NIC would */
+		if (xsk_uses_need_wakeup(pool))
+			xsk_set_rx_need_wakeup(pool);
+		stats->rx_drops++;
+		goto out_consume;
+	}
+	if (xsk_uses_need_wakeup(pool))
+		xsk_clear_rx_need_wakeup(pool);
+
+	if (frame)
+		memcpy(xdp->data, frame->data, len);
+	else
+		skb_copy_bits(skb, 0, xdp->data, len);
+	xsk_buff_set_size(xdp, len);
+
+	/* For the metadata kfuncs, which don't work on frames */
+	((struct veth_xdp_buff *)xdp)->skb = skb;
+
+	act = bpf_prog_run_xdp(xdp_prog, xdp);
+
+	switch (act) {
+	case XDP_PASS:
+		/* The program may have modified the packet, so the skb is
+		 * rebuilt from the UMEM frame.
+		 */
+		break;
+	case XDP_TX:
+		if (unlikely(veth_xdp_tx(rq, xdp, bq) < 0)) {
+			trace_xdp_exception(rq->dev, xdp_prog, act);
+			stats->rx_drops++;
+			xsk_buff_free(xdp);
+		} else {
+			stats->xdp_tx++;
+		}
+		goto out_consume;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(rq->dev, xdp, xdp_prog)) {
+			stats->rx_drops++;
+			xsk_buff_free(xdp);
+		} else {
+			stats->xdp_redirect++;
+		}
+		goto out_consume;
+	default:
+		bpf_warn_invalid_xdp_action(rq->dev, xdp_prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+		trace_xdp_exception(rq->dev, xdp_prog, act);
+		fallthrough;
+	case XDP_DROP:
+		stats->xdp_drops++;
+		xsk_buff_free(xdp);
+		goto out_consume;
+	}
+	rcu_read_unlock();
+
+	skb = veth_xsk_build_skb(rq, xdp, skb);
+	veth_ptr_free(ptr);
+	if (likely(skb))
+		napi_gro_receive(&rq->xdp_napi, skb);
+	else
+		stats->rx_drops++;
+	return true;
+
+out_consume:
+	rcu_read_unlock();
+	veth_ptr_free(ptr);
+	return true;
+out_fallback:
+	rcu_read_unlock();
+	return false;
+}
+
 static int veth_xdp_rcv(struct veth_rq *rq, int budget,
 			struct veth_xdp_tx_bq *bq,
 			struct veth_stats *stats)
 {
+	bool xsk = rcu_access_pointer(rq->xsk_pool);
 	int i, done = 0, n_xdpf = 0;
 	void *xdpf[VETH_XDP_BATCH];
 
@@ -952,6 +1112,11 @@ static int veth_xdp_rcv(struct veth_rq *rq, int budget,
 		if (!ptr)
 			break;
 
+		if (xsk && veth_xsk_rcv_one(rq, ptr, bq, stats)) {
+			done++;
+			continue;
+		}
+
 		if (veth_is_xdp_frame(ptr)) {
 			/* ndo_xdp_xmit */
 			struct xdp_frame *frame = veth_ptr_to_xdp(ptr);
@@ -997,6 +1162,57 @@ static int veth_xdp_rcv(struct veth_rq *rq, int budget,
 	return done;
 }
 
+/* Transmit from the AF_XDP socket bound to @rq's queue to the peer.  Returns
+ * true if the budget was used up.
+ */
+static bool veth_xsk_xmit(struct veth_rq *rq, int budget)
+{
+	struct veth_priv *priv = netdev_priv(rq->dev);
+	struct xsk_buff_pool *pool;
+	struct xdp_desc desc;
+	int sent = 0;
+
+	rcu_read_lock();
+	pool = rcu_dereference(rq->xsk_pool);
+	if (!pool)
+		goto out;
+
+	while (sent < budget && xsk_tx_peek_desc(pool, &desc)) {
+		struct sk_buff *skb;
+
+		sent++;
+		skb = napi_alloc_skb(&rq->xdp_napi, desc.len);
+		if (unlikely(!skb)) {
+			atomic64_inc(&priv->dropped);
+			continue;
+		}
+
+		skb_put_data(skb, xsk_buff_raw_get_data(pool, desc.addr),
+			     desc.len);
+		skb_set_queue_mapping(skb, rq->xsk_rxq.queue_index);
+		skb->dev = rq->dev;
+		veth_xmit(skb, rq->dev);
+	}
+
+	/* The data has been copied out, so the descriptors can be completed
+	 * right away.
+	 */
+	if (sent) {
+		xsk_tx_release(pool);
+		xsk_tx_completed(pool, sent);
+	}
+
+	if (xsk_uses_need_wakeup(pool)) {
+		if (sent < budget)
+			xsk_set_tx_need_wakeup(pool);
+		else
+			xsk_clear_tx_need_wakeup(pool);
+	}
+out:
+	rcu_read_unlock();
+	return sent >= budget;
+}
+
 static int veth_poll(struct napi_struct *napi, int budget)
 {
 	struct veth_rq *rq =
@@ -1013,6 +1229,9 @@ static int veth_poll(struct napi_struct *napi, int budget)
 	if (stats.xdp_redirect > 0)
 		xdp_do_flush();
 
+	if (rcu_access_pointer(rq->xsk_pool) && veth_xsk_xmit(rq, budget))
+		done = budget;
+
 	if (done < budget && napi_complete_done(napi, done)) {
 		/* Write rx_notify_masked before reading ptr_ring */
 		smp_store_mb(rq->rx_notify_masked, false);
@@ -1331,7 +1550,8 @@ static void veth_set_xdp_features(struct net_device *dev)
 		struct veth_priv *priv_peer = netdev_priv(peer);
 		xdp_features_t val = NETDEV_XDP_ACT_BASIC |
 				     NETDEV_XDP_ACT_REDIRECT |
-				     NETDEV_XDP_ACT_RX_SG;
+				     NETDEV_XDP_ACT_RX_SG |
+				     NETDEV_XDP_ACT_XSK_ZEROCOPY;
 
 		if (priv_peer->_xdp_prog || veth_gro_requested(peer))
 			val |= NETDEV_XDP_ACT_NDO_XMIT |
@@ -1349,7 +1569,7 @@ static int veth_set_channels(struct net_device *dev,
 	unsigned int old_rx_count, new_rx_count;
 	struct veth_priv *peer_priv;
 	struct net_device *peer;
-	int err;
+	int err, i;
 
 	/* sanity check. Upper bounds are already enforced by the caller */
 	if (!ch->rx_count || !ch->tx_count)
@@ -1364,6 +1584,11 @@ static int veth_set_channels(struct net_device *dev,
 	if (peer && peer_priv && peer_priv->_xdp_prog && ch->tx_count > peer->real_num_rx_queues)
 		return -EINVAL;
 
+	/* AF_XDP sockets are bound to rx queues */
+	for (i = ch->rx_count; i < dev->real_num_rx_queues; i++)
+		if (rtnl_dereference(priv->rq[i].xsk_pool))
+			return -EBUSY;
+
 	old_rx_count = dev->real_num_rx_queues;
 	new_rx_count = ch->rx_count;
 	if (netif_running(dev)) {
@@ -1687,11 +1912,91 @@ err:
 	return err;
 }
 
+static int veth_xsk_pool_enable(struct net_device *dev,
+				struct xsk_buff_pool *pool, u16 qid)
+{
+	struct veth_priv *priv = netdev_priv(dev);
+	struct veth_rq *rq;
+	int err;
+
+	/* veth_xdp_buff::skb lives in the xsk buffer's private area */
+	XSK_CHECK_PRIV_TYPE(struct veth_xdp_buff);
+
+	if (qid >= dev->real_num_rx_queues)
+		return -EINVAL;
+
+	rq = &priv->rq[qid];
+	if (rtnl_dereference(rq->xsk_pool))
+		return -EBUSY;
+
+	err = xdp_rxq_info_reg(&rq->xsk_rxq, dev, qid, rq->xdp_napi.napi_id);
+	if (err < 0)
+		return err;
+
+	err = xdp_rxq_info_reg_mem_model(&rq->xsk_rxq, MEM_TYPE_XSK_BUFF_POOL,
+					 NULL);
+	if (err < 0) {
+		xdp_rxq_info_unreg(&rq->xsk_rxq);
+		return err;
+	}
+	xsk_pool_set_rxq_info(pool, &rq->xsk_rxq);
+
+	rcu_assign_pointer(rq->xsk_pool, pool);
+	return 0;
+}
+
+static int veth_xsk_pool_disable(struct net_device *dev, u16 qid)
+{
+	struct veth_priv *priv = netdev_priv(dev);
+	struct veth_rq *rq;
+
+	if (qid >= dev->real_num_rx_queues)
+		return -EINVAL;
+
+	rq = &priv->rq[qid];
+	if (!rtnl_dereference(rq->xsk_pool))
+		return -EINVAL;
+
+	RCU_INIT_POINTER(rq->xsk_pool, NULL);
+	/* Wait for NAPI to stop using the pool */
+	synchronize_net();
+
+	xdp_rxq_info_unreg(&rq->xsk_rxq);
+	return 0;
+}
+
+static int veth_xsk_wakeup(struct net_device *dev, u32 qid, u32 flags)
+{
+	struct veth_priv *priv = netdev_priv(dev);
+	struct veth_rq *rq;
+
+	if (!netif_running(dev))
+		return -ENETDOWN;
+
+	if (qid >= dev->real_num_rx_queues)
+		return -EINVAL;
+
+	rq = &priv->rq[qid];
+	if (!rcu_access_pointer(rq->xsk_pool) ||
+	    !rcu_access_pointer(rq->napi))
+		return -ENXIO;
+
+	local_bh_disable();
+	__veth_xdp_flush(rq);
+	local_bh_enable();
+
+	return 0;
+}
+
 static int veth_xdp(struct net_device *dev, struct netdev_bpf *xdp)
 {
 	switch (xdp->command) {
 	case XDP_SETUP_PROG:
 		return veth_xdp_set(dev, xdp->prog, xdp->extack);
+	case XDP_SETUP_XSK_POOL:
+		return xdp->xsk.pool ?
+		       veth_xsk_pool_enable(dev, xdp->xsk.pool, xdp->xsk.queue_id) :
+		       veth_xsk_pool_disable(dev, xdp->xsk.queue_id);
 	default:
 		return -EINVAL;
 	}
@@ -1759,6 +2064,7 @@ static const struct net_device_ops veth_netdev_ops = {
 	.ndo_set_rx_headroom	= veth_set_rx_headroom,
 	.ndo_bpf		= veth_xdp,
 	.ndo_xdp_xmit		= veth_ndo_xdp_xmit,
+	.ndo_xsk_wakeup		= veth_xsk_wakeup,
 	.ndo_get_peer_dev	= veth_peer_dev,
 };
 
@@ -1782,6 +2088,7 @@ static void veth_setup(struct net_device *dev)
 	dev->priv_flags |= IFF_LIVE_ADDR_CHANGE;
 	dev->priv_flags |= IFF_NO_QUEUE;
 	dev->priv_flags |= IFF_PHONY_HEADROOM;
+	dev->priv_flags |= IFF_XSK_ZC_NO_DMA;
 
 	dev->netdev_ops = &veth_netdev_ops;
 	dev->xdp_metadata_ops = &veth_xdp_metadata_ops;
@@ -239,17 +239,113 @@ void wg_packet_send_keepalive(struct wg_peer *peer)
 	wg_packet_send_staged_packets(peer);
 }
 
+/* UDP GSO packets must still fit into a single IPv4 datagram. */
+#define GSO_MAX_PAYLOAD \
+	(U16_MAX - sizeof(struct iphdr) - sizeof(struct udphdr))
+
+/* Counts how many packets, starting at skb, may share a UDP GSO packet: all
+ * the same length, except for the last which may be shorter, and all with the
+ * same outer DS field.
+ */
+static unsigned int gso_run_length(struct sk_buff *skb, unsigned int *total)
+{
+	unsigned int len = skb->len, segs = 1;
+	u8 ds = PACKET_CB(skb)->ds;
+
+	*total = len;
+	for (skb = skb->next; skb && segs < UDP_MAX_SEGMENTS; skb = skb->next) {
+		if (skb->len > len || PACKET_CB(skb)->ds != ds ||
+		    *total + skb->len > GSO_MAX_PAYLOAD)
+			break;
+		*total += skb->len;
+		++segs;
+		if (skb->len < len)
+			break;
+	}
+	return segs;
+}
+
+/* Copies a run of encrypted packets into a single UDP GSO packet, so that it
+ * traverses the UDP and IP layers once and may be split by the hardware. The
+ * bytes on the wire are identical to sending each packet by itself.
+ */
+static struct sk_buff *gso_coalesce(struct sk_buff *first, unsigned int segs,
+				    unsigned int total)
+{
+	unsigned int i, copied, chunk, frag = 0, frag_off = 0;
+	struct sk_buff *gso, *skb;
+	skb_frag_t *f;
+	int err;
+
+	gso = alloc_skb_with_frags(SKB_HEADER_LEN, total,
+				   PAGE_ALLOC_COSTLY_ORDER, &err, GFP_ATOMIC);
+	if (unlikely(!gso))
+		return NULL;
+	skb_reserve(gso, SKB_HEADER_LEN);
+	gso->len = total;
+	gso->data_len = total;
+
+	for (i = 0, skb = first; i < segs; ++i, skb = skb->next) {
+		for (copied = 0; copied < skb->len; copied += chunk) {
+			f = &skb_shinfo(gso)->frags[frag];
+			chunk = min(skb_frag_size(f) - frag_off,
+				    skb->len - copied);
+			if (unlikely(skb_copy_bits(skb, copied,
+						   skb_frag_address(f) + frag_off,
+						   chunk))) {
+				kfree_skb(gso);
+				return NULL;
+			}
+			frag_off += chunk;
+			if (frag_off == skb_frag_size(f)) {
+				++frag;
+				frag_off = 0;
+			}
+		}
+	}
+
+	skb_copy_hash(gso, first);
+	gso->priority = first->priority;
+	skb_shinfo(gso)->gso_size = first->len;
+	skb_shinfo(gso)->gso_type = SKB_GSO_UDP_L4;
+	skb_shinfo(gso)->gso_segs = segs;
+	/* The UDP header is pushed right in front of the data. */
+	gso->ip_summed = CHECKSUM_PARTIAL;
+	gso->csum_start = skb_headroom(gso) - sizeof(struct udphdr);
+	gso->csum_offset = offsetof(struct udphdr, check);
+	return gso;
+}
+
 static void wg_packet_create_data_done(struct wg_peer *peer, struct sk_buff *first)
 {
-	struct sk_buff *skb, *next;
+	struct sk_buff *skb, *next, *gso;
 	bool is_keepalive, data_sent = false;
+	unsigned int segs, total;
+	u8 ds;
 
 	wg_timers_any_authenticated_packet_traversal(peer);
 	wg_timers_any_authenticated_packet_sent(peer);
-	skb_list_walk_safe(first, skb, next) {
-		is_keepalive = skb->len == message_data_len(0);
-		if (likely(!wg_socket_send_skb_to_peer(peer, skb,
-				PACKET_CB(skb)->ds) && !is_keepalive))
+	for (skb = first; skb; skb = next) {
+		segs = gso_run_length(skb, &total);
+		gso = segs > 1 ? gso_coalesce(skb, segs, total) : NULL;
+		if (!gso) {
+			next = skb->next;
+			is_keepalive = skb->len == message_data_len(0);
+			if (likely(!wg_socket_send_skb_to_peer(peer, skb,
+					PACKET_CB(skb)->ds) && !is_keepalive))
+				data_sent = true;
+			continue;
+		}
+
+		ds = PACKET_CB(skb)->ds;
+		is_keepalive = true;
+		for (next = skb; segs--; skb = next) {
+			next = skb->next;
+			is_keepalive &= skb->len == message_data_len(0);
+			consume_skb(skb);
+		}
+		if (likely(!wg_socket_send_skb_to_peer(peer, gso, ds) &&
+			   !is_keepalive))
 			data_sent = true;
 	}
 
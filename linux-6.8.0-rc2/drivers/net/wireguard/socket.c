@@ -15,6 +15,7 @@
 #include <linux/if_ether.h>
 #include <linux/inetdevice.h>
 #include <net/udp_tunnel.h>
+#include <net/udp.h>
 #include <net/ipv6.h>
 
 static int send4(struct wg_device *wg, struct sk_buff *skb,
@@ -315,6 +316,7 @@ void wg_socket_clear_peer_endpoint_src(struct wg_peer *peer)
 
 static int wg_receive(struct sock *sk, struct sk_buff *skb)
 {
+	struct sk_buff *segs, *next;
 	struct wg_device *wg;
 
 	if (unlikely(!sk))
@@ -323,7 +325,22 @@ static int wg_receive(struct sock *sk, struct sk_buff *skb)
 	if (unlikely(!wg))
 		goto err;
 	skb_mark_not_on_list(skb);
-	wg_packet_receive(wg, skb);
+	if (likely(!skb_is_gso(skb))) {
+		wg_packet_receive(wg, skb);
+		return 0;
+	}
+
+	/* A batch aggregated by UDP GRO, which we split back into the
+	 * individual messages before they are looked at.
+	 */
+	__skb_push(skb, -skb_mac_offset(skb));
+	segs = udp_rcv_segment(sk, skb, sk->sk_family == AF_INET);
+	skb_list_walk_safe(segs, skb, next) {
+		skb_mark_not_on_list(skb);
+		__skb_pull(skb, skb_transport_offset(skb));
+		udp_post_segment_fix_csum(skb);
+		wg_packet_receive(wg, skb);
+	}
 	return 0;
 
 err:
@@ -344,6 +361,9 @@ static void set_sock_opts(struct socket *sock)
 	sock->sk->sk_allocation = GFP_ATOMIC;
 	sock->sk->sk_sndbuf = INT_MAX;
 	sk_set_memalloc(sock->sk);
+	/* Let UDP GRO aggregate incoming messages; wg_receive() splits them. */
+	udp_set_bit(GRO_ENABLED, sock->sk);
+	udp_allow_gso(sock->sk);
 }
 
 int wg_socket_init(struct wg_device *wg, u16 port)
@@ -440,6 +440,8 @@ void nvme_complete_batch_req(struct request *req)
 	trace_nvme_complete_rq(req);
 	nvme_cleanup_cmd(req);
 	nvme_end_req_zoned(req);
+	if (req->cmd_flags & REQ_NVME_MPATH)
+		nvme_mpath_end_request(req);
 }
 EXPORT_SYMBOL_GPL(nvme_complete_batch_req);
 
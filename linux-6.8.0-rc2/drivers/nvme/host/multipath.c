@@ -17,6 +17,8 @@ MODULE_PARM_DESC(multipath,
 static const char *nvme_iopolicy_names[] = {
 	[NVME_IOPOLICY_NUMA]	= "numa",
 	[NVME_IOPOLICY_RR]	= "round-robin",
+	[NVME_IOPOLICY_QD]	= "queue-depth",
+	[NVME_IOPOLICY_ST]	= "service-time",
 };
 
 static int iopolicy = NVME_IOPOLICY_NUMA;
@@ -29,6 +31,10 @@ static int nvme_set_iopolicy(const char *val, const struct kernel_param *kp)
 		iopolicy = NVME_IOPOLICY_NUMA;
 	else if (!strncmp(val, "round-robin", 11))
 		iopolicy = NVME_IOPOLICY_RR;
+	else if (!strncmp(val, "queue-depth", 11))
+		iopolicy = NVME_IOPOLICY_QD;
+	else if (!strncmp(val, "service-time", 12))
+		iopolicy = NVME_IOPOLICY_ST;
 	else
 		return -EINVAL;
 
@@ -43,7 +49,7 @@ static int nvme_get_iopolicy(char *buf, const struct kernel_param *kp)
 module_param_call(iopolicy, nvme_set_iopolicy, nvme_get_iopolicy,
 	&iopolicy, 0644);
 MODULE_PARM_DESC(iopolicy,
-	"Default multipath I/O policy; 'numa' (default) or 'round-robin'");
+	"Default multipath I/O policy; 'numa' (default), 'round-robin', 'queue-depth' or 'service-time'");
 
 void nvme_mpath_default_iopolicy(struct nvme_subsystem *subsys)
 {
@@ -80,6 +86,51 @@ void nvme_mpath_start_freeze(struct nvme_subsystem *subsys)
 			blk_freeze_queue_start(h->disk->queue);
 }
 
+/*
+ * The queue-depth and service-time iopolicies need the number of requests
+ * outstanding on each controller, service-time also their latency.  The
+ * flags make sure a request that was counted is uncounted exactly once,
+ * also when it is retried or the iopolicy changes meanwhile.
+ */
+static void nvme_mpath_start_active(struct request *rq)
+{
+	struct nvme_ns *ns = rq->q->queuedata;
+	int iopolicy = READ_ONCE(ns->head->subsys->iopolicy);
+
+	if (iopolicy != NVME_IOPOLICY_QD && iopolicy != NVME_IOPOLICY_ST)
+		return;
+
+	if (!(nvme_req(rq)->flags & NVME_MPATH_CNT_ACTIVE)) {
+		atomic_inc(&ns->ctrl->nr_active);
+		nvme_req(rq)->flags |= NVME_MPATH_CNT_ACTIVE;
+	}
+	if (iopolicy == NVME_IOPOLICY_ST) {
+		nvme_req(rq)->flags |= NVME_MPATH_SVC_TIME;
+		nvme_req(rq)->svc_start_ns = ktime_get_ns();
+	}
+}
+
+static void nvme_mpath_end_active(struct request *rq)
+{
+	struct nvme_ns *ns = rq->q->queuedata;
+	struct nvme_request *nr = nvme_req(rq);
+	struct nvme_ctrl *ctrl = ns->ctrl;
+	u64 lat, avg;
+
+	if (nr->flags & NVME_MPATH_CNT_ACTIVE) {
+		atomic_dec(&ctrl->nr_active);
+		nr->flags &= ~NVME_MPATH_CNT_ACTIVE;
+	}
+	if (nr->flags & NVME_MPATH_SVC_TIME) {
+		nr->flags &= ~NVME_MPATH_SVC_TIME;
+		/* racy, but this is only an estimate: weight 1/8 */
+		lat = ktime_get_ns() - nr->svc_start_ns;
+		avg = atomic64_read(&ctrl->svc_time_ns);
+		atomic64_set(&ctrl->svc_time_ns,
+			     avg ? avg - (avg >> 3) + (lat >> 3) : lat);
+	}
+}
+
 void nvme_failover_req(struct request *req)
 {
 	struct nvme_ns *ns = req->q->queuedata;
@@ -118,6 +169,7 @@ void nvme_failover_req(struct request *req)
 	blk_steal_bios(&ns->head->requeue_list, req);
 	spin_unlock_irqrestore(&ns->head->requeue_lock, flags);
 
+	nvme_mpath_end_active(req);
 	blk_mq_end_request(req, 0);
 	kblockd_schedule_work(&ns->head->requeue_work);
 }
@@ -127,6 +179,8 @@ void nvme_mpath_start_request(struct request *rq)
 	struct nvme_ns *ns = rq->q->queuedata;
 	struct gendisk *disk = ns->head->disk;
 
+	nvme_mpath_start_active(rq);
+
 	if (!blk_queue_io_stat(disk->queue) || blk_rq_is_passthrough(rq))
 		return;
 
@@ -140,6 +194,8 @@ void nvme_mpath_end_request(struct request *rq)
 {
 	struct nvme_ns *ns = rq->q->queuedata;
 
+	nvme_mpath_end_active(rq);
+
 	if (!(nvme_req(rq)->flags & NVME_MPATH_IO_STATS))
 		return;
 	bdev_end_io_acct(ns->head->disk->part0, req_op(rq),
@@ -329,6 +385,51 @@ out:
 	return found;
 }
 
+/*
+ * Pick the path with the fewest outstanding requests, or with service-time
+ * the lowest expected latency for a new request, i.e. the average latency
+ * scaled by the requests it has to queue behind.  Paths without samples
+ * yet look idle, so they get some.
+ */
+static struct nvme_ns *nvme_least_busy_path(struct nvme_ns_head *head,
+		bool svc_time)
+{
+	struct nvme_ns *best_opt = NULL, *best_nonopt = NULL, *ns;
+	u64 min_opt = U64_MAX, min_nonopt = U64_MAX, cost;
+
+	list_for_each_entry_rcu(ns, &head->list, siblings) {
+		if (nvme_path_is_disabled(ns))
+			continue;
+
+		cost = atomic_read(&ns->ctrl->nr_active);
+		if (svc_time)
+			cost = (cost + 1) *
+				atomic64_read(&ns->ctrl->svc_time_ns);
+
+		switch (ns->ana_state) {
+		case NVME_ANA_OPTIMIZED:
+			if (cost < min_opt) {
+				min_opt = cost;
+				best_opt = ns;
+			}
+			break;
+		case NVME_ANA_NONOPTIMIZED:
+			if (cost < min_nonopt) {
+				min_nonopt = cost;
+				best_nonopt = ns;
+			}
+			break;
+		default:
+			break;
+		}
+
+		if (min_opt == 0)
+			return best_opt;
+	}
+
+	return best_opt ? best_opt : best_nonopt;
+}
+
 static inline bool nvme_path_is_optimized(struct nvme_ns *ns)
 {
 	return ns->ctrl->state == NVME_CTRL_LIVE &&
@@ -340,6 +441,15 @@ inline struct nvme_ns *nvme_find_path(struct nvme_ns_head *head)
 	int node = numa_node_id();
 	struct nvme_ns *ns;
 
+	switch (READ_ONCE(head->subsys->iopolicy)) {
+	case NVME_IOPOLICY_QD:
+		return nvme_least_busy_path(head, false);
+	case NVME_IOPOLICY_ST:
+		return nvme_least_busy_path(head, true);
+	default:
+		break;
+	}
+
 	ns = srcu_dereference(head->current_path[node], &head->srcu);
 	if (unlikely(!ns))
 		return __nvme_find_path(head, node);
@@ -177,6 +177,7 @@ struct nvme_request {
 	u16			status;
 #ifdef CONFIG_NVME_MULTIPATH
 	unsigned long		start_time;
+	u64			svc_start_ns;
 #endif
 	struct nvme_ctrl	*ctrl;
 };
@@ -190,6 +191,8 @@ enum {
 	NVME_REQ_CANCELLED		= (1 << 0),
 	NVME_REQ_USERCMD		= (1 << 1),
 	NVME_MPATH_IO_STATS		= (1 << 2),
+	NVME_MPATH_CNT_ACTIVE		= (1 << 3),
+	NVME_MPATH_SVC_TIME		= (1 << 4),
 };
 
 static inline struct nvme_request *nvme_req(struct request *req)
@@ -353,6 +356,9 @@ struct nvme_ctrl {
 	size_t ana_log_size;
 	struct timer_list anatt_timer;
 	struct work_struct ana_work;
+	/* for the queue-depth and service-time iopolicies */
+	atomic_t nr_active;
+	atomic64_t svc_time_ns;	/* moving average of the completion latency */
 #endif
 
 #ifdef CONFIG_NVME_HOST_AUTH
@@ -401,6 +407,8 @@ static inline enum nvme_ctrl_state nvme_ctrl_state(struct nvme_ctrl *ctrl)
 enum nvme_iopolicy {
 	NVME_IOPOLICY_NUMA,
 	NVME_IOPOLICY_RR,
+	NVME_IOPOLICY_QD,
+	NVME_IOPOLICY_ST,
 };
 
 struct nvme_subsystem {
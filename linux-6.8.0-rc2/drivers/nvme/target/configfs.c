@@ -688,6 +688,28 @@ static ssize_t nvmet_ns_buffered_io_store(struct config_item *item,
 
 CONFIGFS_ATTR(nvmet_ns_, buffered_io);
 
+static ssize_t nvmet_ns_buffered_io_inline_show(struct config_item *item,
+		char *page)
+{
+	struct nvmet_ns *ns = to_nvmet_ns(item);
+
+	return sprintf(page, "%lld\n", percpu_counter_sum(
+			&ns->buffered_io_stats[NVMET_BUFFERED_IO_INLINE]));
+}
+
+CONFIGFS_ATTR_RO(nvmet_ns_, buffered_io_inline);
+
+static ssize_t nvmet_ns_buffered_io_queued_show(struct config_item *item,
+		char *page)
+{
+	struct nvmet_ns *ns = to_nvmet_ns(item);
+
+	return sprintf(page, "%lld\n", percpu_counter_sum(
+			&ns->buffered_io_stats[NVMET_BUFFERED_IO_QUEUED]));
+}
+
+CONFIGFS_ATTR_RO(nvmet_ns_, buffered_io_queued);
+
 static ssize_t nvmet_ns_revalidate_size_store(struct config_item *item,
 		const char *page, size_t count)
 {
@@ -721,6 +743,8 @@ static struct configfs_attribute *nvmet_ns_attrs[] = {
 	&nvmet_ns_attr_ana_grpid,
 	&nvmet_ns_attr_enable,
 	&nvmet_ns_attr_buffered_io,
+	&nvmet_ns_attr_buffered_io_inline,
+	&nvmet_ns_attr_buffered_io_queued,
 	&nvmet_ns_attr_revalidate_size,
 #ifdef CONFIG_PCI_P2PDMA
 	&nvmet_ns_attr_p2pmem,
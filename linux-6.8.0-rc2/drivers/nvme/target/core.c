@@ -664,6 +664,8 @@ void nvmet_ns_free(struct nvmet_ns *ns)
 	nvmet_ana_group_enabled[ns->anagrpid]--;
 	up_write(&nvmet_ana_sem);
 
+	percpu_counter_destroy_many(ns->buffered_io_stats,
+				    NVMET_BUFFERED_IO_NR);
 	kfree(ns->device_path);
 	kfree(ns);
 }
@@ -676,6 +678,12 @@ struct nvmet_ns *nvmet_ns_alloc(struct nvmet_subsys *subsys, u32 nsid)
 	if (!ns)
 		return NULL;
 
+	if (percpu_counter_init_many(ns->buffered_io_stats, 0, GFP_KERNEL,
+				     NVMET_BUFFERED_IO_NR)) {
+		kfree(ns);
+		return NULL;
+	}
+
 	init_completion(&ns->disable_done);
 
 	ns->nsid = nsid;
@@ -179,6 +179,14 @@ static bool nvmet_file_execute_io(struct nvmet_req *req, int ki_flags)
 
 	ret = nvmet_file_submit_bvec(req, pos, bv_cnt, total_len, ki_flags);
 
+	/*
+	 * A buffered IOCB_NOWAIT attempt stops short at the first page that
+	 * isn't cached, redo the whole command from the worker then.  That
+	 * is harmless for reads, and writes just store the same data again.
+	 */
+	if ((ki_flags & IOCB_NOWAIT) && ret >= 0 && ret < total_len)
+		return false;
+
 	switch (ret) {
 	case -EIOCBQUEUED:
 		return true;
@@ -198,6 +206,9 @@ static bool nvmet_file_execute_io(struct nvmet_req *req, int ki_flags)
 	}
 
 complete:
+	if (ki_flags & IOCB_NOWAIT)
+		percpu_counter_inc(
+			&req->ns->buffered_io_stats[NVMET_BUFFERED_IO_INLINE]);
 	nvmet_file_io_done(&req->f.iocb, ret);
 	return true;
 }
@@ -211,6 +222,8 @@ static void nvmet_file_buffered_io_work(struct work_struct *w)
 
 static void nvmet_file_submit_buffered_io(struct nvmet_req *req)
 {
+	percpu_counter_inc(
+		&req->ns->buffered_io_stats[NVMET_BUFFERED_IO_QUEUED]);
 	INIT_WORK(&req->f.work, nvmet_file_buffered_io_work);
 	queue_work(buffered_io_wq, &req->f.work);
 }
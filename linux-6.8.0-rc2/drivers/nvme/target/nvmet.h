@@ -11,6 +11,7 @@
 #include <linux/device.h>
 #include <linux/kref.h>
 #include <linux/percpu-refcount.h>
+#include <linux/percpu_counter.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/uuid.h>
@@ -56,6 +57,13 @@
 #define IPO_IATTR_CONNECT_SQE(x)	\
 	(cpu_to_le32(offsetof(struct nvmf_connect_command, x)))
 
+/* how buffered file I/O was executed, see nvmet_file_execute_rw() */
+enum {
+	NVMET_BUFFERED_IO_INLINE,	/* inline with IOCB_NOWAIT */
+	NVMET_BUFFERED_IO_QUEUED,	/* by buffered_io_wq */
+	NVMET_BUFFERED_IO_NR,
+};
+
 struct nvmet_ns {
 	struct percpu_ref	ref;
 	struct bdev_handle	*bdev_handle;
@@ -79,6 +87,7 @@ struct nvmet_ns {
 
 	struct completion	disable_done;
 	mempool_t		*bvec_pool;
+	struct percpu_counter	buffered_io_stats[NVMET_BUFFERED_IO_NR];
 
 	struct pci_dev		*p2p_dev;
 	int			use_p2pmem;
@@ -51,6 +51,102 @@ bch2_btree_key_cache_find(struct bch_fs *c, enum btree_id btree_id, struct bpos
 				      bch2_btree_key_cache_params);
 }
 
+/**
+ * bch2_btree_key_cache_peek_lockless - copy a key out of the key cache without
+ * taking locks
+ * @trans:	btree transaction, which must not have any pending updates
+ * @btree_id:	btree to look up
+ * @pos:	position of the cached key
+ * @dst:	buffer to copy the key to
+ * @dst_u64s:	size of @dst, in u64s
+ *
+ * Read-mostly lookups of keys in the key cache, e.g. inodes for stat(), would
+ * otherwise bounce the key cache entry's six lock between CPUs. Instead, copy
+ * the key out under RCU and use the lock sequence number to detect a
+ * concurrent writer.
+ *
+ * Return: true if @dst was filled in; if false, the caller must do a normal
+ * (locked) lookup, which will also fill the key cache if need be.
+ */
+bool bch2_btree_key_cache_peek_lockless(struct btree_trans *trans,
+					enum btree_id btree_id, struct bpos pos,
+					struct bkey_i *dst, unsigned dst_u64s)
+{
+	struct bkey_cached *ck;
+	struct bkey_i *k;
+	unsigned u64s;
+	u32 seq;
+	bool ret = false;
+
+	/* Cached key objects aren't reused until an SRCU barrier has passed */
+	if (unlikely(!trans->srcu_held || trans->nr_updates))
+		return false;
+
+	rcu_read_lock();
+	ck = bch2_btree_key_cache_find(trans->c, btree_id, pos);
+	if (!ck || !six_lock_seq_read_begin(&ck->c.lock, &seq))
+		goto out;
+
+	if (ck->key.btree_id != btree_id ||
+	    !bpos_eq(ck->key.pos, pos) ||
+	    !READ_ONCE(ck->valid))
+		goto out;
+
+	k = READ_ONCE(ck->k);
+	if (!k)
+		goto out;
+
+	u64s = READ_ONCE(k->k.u64s);
+	if (u64s > dst_u64s || u64s > READ_ONCE(ck->u64s))
+		goto out;
+
+	memcpy(dst, k, u64s * sizeof(u64));
+
+	if (six_lock_seq_read_retry(&ck->c.lock, seq))
+		goto out;
+
+	if (!test_bit(BKEY_CACHED_ACCESSED, &ck->flags))
+		set_bit(BKEY_CACHED_ACCESSED, &ck->flags);
+	ret = true;
+out:
+	rcu_read_unlock();
+	return ret;
+}
+
+/*
+ * Cached keys may be read locklessly, by bch2_btree_key_cache_peek_lockless(),
+ * so they must not be freed until after an RCU grace period:
+ */
+struct bkey_cached_key_buf {
+	struct rcu_head		rcu;
+	u64			_data[];
+};
+
+struct bkey_i *bch2_btree_key_cache_key_alloc(unsigned u64s, gfp_t gfp)
+{
+	struct bkey_cached_key_buf *b = kmalloc(struct_size(b, _data, u64s), gfp);
+
+	return b ? (void *) b->_data : NULL;
+}
+
+void bch2_btree_key_cache_key_free(struct bkey_i *k)
+{
+	if (k)
+		kfree_rcu((struct bkey_cached_key_buf *)
+			  ((void *) k - offsetof(struct bkey_cached_key_buf, _data)),
+			  rcu);
+}
+
+static void bkey_cached_free_key(struct bkey_cached *ck)
+{
+	struct bkey_i *k = ck->k;
+
+	WRITE_ONCE(ck->k, NULL);
+	ck->u64s	= 0;
+
+	bch2_btree_key_cache_key_free(k);
+}
+
 static bool bkey_cached_lock_for_evict(struct bkey_cached *ck)
 {
 	if (!six_trylock_intent(&ck->c.lock))
@@ -98,9 +194,7 @@ static void bkey_cached_free(struct btree_key_cache *bc,
 	}
 	atomic_long_inc(&bc->nr_freed);
 
-	kfree(ck->k);
-	ck->k		= NULL;
-	ck->u64s	= 0;
+	bkey_cached_free_key(ck);
 
 	six_unlock_write(&ck->c.lock);
 	six_unlock_intent(&ck->c.lock);
@@ -184,9 +278,7 @@ static void bkey_cached_free_fast(struct btree_key_cache *bc,
 	list_del_init(&ck->list);
 	atomic_long_inc(&bc->nr_freed);
 
-	kfree(ck->k);
-	ck->k		= NULL;
-	ck->u64s	= 0;
+	bkey_cached_free_key(ck);
 
 	bkey_cached_move_to_freelist(bc, ck);
 
@@ -377,7 +469,7 @@ static int btree_key_cache_fill(struct btree_trans *trans,
 	struct btree_iter iter;
 	struct bkey_s_c k;
 	unsigned new_u64s = 0;
-	struct bkey_i *new_k = NULL;
+	struct bkey_i *new_k = NULL, *old_k = NULL;
 	int ret;
 
 	k = bch2_bkey_get_iter(trans, &iter, ck->key.btree_id, ck->key.pos,
@@ -408,11 +500,11 @@ static int btree_key_cache_fill(struct btree_trans *trans,
 
 	if (new_u64s > ck->u64s) {
 		new_u64s = roundup_pow_of_two(new_u64s);
-		new_k = kmalloc(new_u64s * sizeof(u64), GFP_NOWAIT|__GFP_NOWARN);
+		new_k = bch2_btree_key_cache_key_alloc(new_u64s, GFP_NOWAIT|__GFP_NOWARN);
 		if (!new_k) {
 			bch2_trans_unlock(trans);
 
-			new_k = kmalloc(new_u64s * sizeof(u64), GFP_KERNEL);
+			new_k = bch2_btree_key_cache_key_alloc(new_u64s, GFP_KERNEL);
 			if (!new_k) {
 				bch_err(trans->c, "error allocating memory for key cache key, btree %s u64s %u",
 					bch2_btree_id_str(ck->key.btree_id), new_u64s);
@@ -421,7 +513,7 @@ static int btree_key_cache_fill(struct btree_trans *trans,
 			}
 
 			if (!bch2_btree_node_relock(trans, ck_path, 0)) {
-				kfree(new_k);
+				bch2_btree_key_cache_key_free(new_k);
 				trace_and_count(trans->c, trans_restart_relock_key_cache_fill, trans, _THIS_IP_, ck_path);
 				ret = btree_trans_restart(trans, BCH_ERR_transaction_restart_key_cache_fill);
 				goto err;
@@ -429,7 +521,7 @@ static int btree_key_cache_fill(struct btree_trans *trans,
 
 			ret = bch2_trans_relock(trans);
 			if (ret) {
-				kfree(new_k);
+				bch2_btree_key_cache_key_free(new_k);
 				goto err;
 			}
 		}
@@ -437,20 +529,22 @@ static int btree_key_cache_fill(struct btree_trans *trans,
 
 	ret = bch2_btree_node_lock_write(trans, ck_path, &ck_path->l[0].b->c);
 	if (ret) {
-		kfree(new_k);
+		bch2_btree_key_cache_key_free(new_k);
 		goto err;
 	}
 
 	if (new_k) {
-		kfree(ck->k);
+		old_k = ck->k;
 		ck->u64s = new_u64s;
-		ck->k = new_k;
+		WRITE_ONCE(ck->k, new_k);
 	}
 
 	bkey_reassemble(ck->k, k);
 	ck->valid = true;
 	bch2_btree_node_unlock_write(trans, ck_path, ck_path->l[0].b);
 
+	bch2_btree_key_cache_key_free(old_k);
+
 	/* We're not likely to need this iterator again: */
 	set_btree_iter_dontneed(&iter);
 err:
@@ -986,7 +1080,7 @@ void bch2_fs_btree_key_cache_exit(struct btree_key_cache *bc)
 		cond_resched();
 
 		list_del(&ck->list);
-		kfree(ck->k);
+		bch2_btree_key_cache_key_free(ck->k);
 		six_lock_exit(&ck->c.lock);
 		kmem_cache_free(bch2_key_cache, ck);
 	}
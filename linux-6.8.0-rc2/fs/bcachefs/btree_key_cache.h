@@ -25,6 +25,10 @@ int bch2_btree_key_cache_journal_flush(struct journal *,
 
 struct bkey_cached *
 bch2_btree_key_cache_find(struct bch_fs *, enum btree_id, struct bpos);
+struct bkey_i *bch2_btree_key_cache_key_alloc(unsigned, gfp_t);
+void bch2_btree_key_cache_key_free(struct bkey_i *);
+bool bch2_btree_key_cache_peek_lockless(struct btree_trans *, enum btree_id,
+					struct bpos, struct bkey_i *, unsigned);
 
 int bch2_btree_path_traverse_cached(struct btree_trans *, struct btree_path *,
 				    unsigned);
@@ -364,7 +364,7 @@ btree_key_can_insert_cached_slowpath(struct btree_trans *trans, unsigned flags,
 	bch2_trans_unlock_write(trans);
 	bch2_trans_unlock(trans);
 
-	new_k = kmalloc(new_u64s * sizeof(u64), GFP_KERNEL);
+	new_k = bch2_btree_key_cache_key_alloc(new_u64s, GFP_KERNEL);
 	if (!new_k) {
 		bch_err(trans->c, "error allocating memory for key cache key, btree %s u64s %u",
 			bch2_btree_id_str(path->btree_id), new_u64s);
@@ -374,7 +374,7 @@ btree_key_can_insert_cached_slowpath(struct btree_trans *trans, unsigned flags,
 	ret =   bch2_trans_relock(trans) ?:
 		bch2_trans_lock_write(trans);
 	if (unlikely(ret)) {
-		kfree(new_k);
+		bch2_btree_key_cache_key_free(new_k);
 		return ret;
 	}
 
@@ -384,9 +384,9 @@ btree_key_can_insert_cached_slowpath(struct btree_trans *trans, unsigned flags,
 		if (i->old_v == &ck->k->v)
 			i->old_v = &new_k->v;
 
-	kfree(ck->k);
+	bch2_btree_key_cache_key_free(ck->k);
 	ck->u64s	= new_u64s;
-	ck->k		= new_k;
+	WRITE_ONCE(ck->k, new_k);
 	return 0;
 }
 
@@ -415,16 +415,20 @@ static int btree_key_can_insert_cached(struct btree_trans *trans, unsigned flags
 		return 0;
 
 	new_u64s	= roundup_pow_of_two(u64s);
-	new_k		= krealloc(ck->k, new_u64s * sizeof(u64), GFP_NOWAIT|__GFP_NOWARN);
+	new_k		= bch2_btree_key_cache_key_alloc(new_u64s, GFP_NOWAIT|__GFP_NOWARN);
 	if (unlikely(!new_k))
 		return btree_key_can_insert_cached_slowpath(trans, flags, path, new_u64s);
 
+	if (ck->k)
+		memcpy(new_k, ck->k, ck->u64s * sizeof(u64));
+
 	trans_for_each_update(trans, i)
 		if (i->old_v == &ck->k->v)
 			i->old_v = &new_k->v;
 
+	bch2_btree_key_cache_key_free(ck->k);
 	ck->u64s	= new_u64s;
-	ck->k		= new_k;
+	WRITE_ONCE(ck->k, new_k);
 	return 0;
 }
 
@@ -324,19 +324,14 @@ int bch2_inode_unpack(struct bkey_s_c k,
 	return bch2_inode_unpack_slowpath(k, unpacked);
 }
 
-static int bch2_inode_peek_nowarn(struct btree_trans *trans,
-		    struct btree_iter *iter,
-		    struct bch_inode_unpacked *inode,
-		    subvol_inum inum, unsigned flags)
+static int __bch2_inode_peek(struct btree_trans *trans,
+			     struct btree_iter *iter,
+			     struct bch_inode_unpacked *inode,
+			     subvol_inum inum, u32 snapshot, unsigned flags)
 {
 	struct bkey_s_c k;
-	u32 snapshot;
 	int ret;
 
-	ret = bch2_subvolume_get_snapshot(trans, inum.subvol, &snapshot);
-	if (ret)
-		return ret;
-
 	k = bch2_bkey_get_iter(trans, iter, BTREE_ID_inodes,
 			       SPOS(0, inum.inum, snapshot),
 			       flags|BTREE_ITER_CACHED);
@@ -358,6 +353,21 @@ err:
 	return ret;
 }
 
+static int bch2_inode_peek_nowarn(struct btree_trans *trans,
+		    struct btree_iter *iter,
+		    struct bch_inode_unpacked *inode,
+		    subvol_inum inum, unsigned flags)
+{
+	u32 snapshot;
+	int ret;
+
+	ret = bch2_subvolume_get_snapshot(trans, inum.subvol, &snapshot);
+	if (ret)
+		return ret;
+
+	return __bch2_inode_peek(trans, iter, inode, inum, snapshot, flags);
+}
+
 int bch2_inode_peek(struct btree_trans *trans,
 		    struct btree_iter *iter,
 		    struct bch_inode_unpacked *inode,
@@ -897,29 +907,51 @@ err:
 	return ret;
 }
 
-int bch2_inode_find_by_inum_nowarn_trans(struct btree_trans *trans,
-				  subvol_inum inum,
-				  struct bch_inode_unpacked *inode)
+/*
+ * Read only lookups are usually satisfied by copying the inode out of the key
+ * cache, without taking the key cache entry's lock:
+ */
+static int __bch2_inode_find_by_inum_trans(struct btree_trans *trans,
+					   subvol_inum inum,
+					   struct bch_inode_unpacked *inode)
 {
+	struct bkey_inode_buf buf;
 	struct btree_iter iter;
+	u32 snapshot;
 	int ret;
 
-	ret = bch2_inode_peek_nowarn(trans, &iter, inode, inum, 0);
+	ret = bch2_subvolume_get_snapshot(trans, inum.subvol, &snapshot);
+	if (ret)
+		return ret;
+
+	/* bch2_inode_unpack() may read up to 7 bytes past the end of the key */
+	if (bch2_btree_key_cache_peek_lockless(trans, BTREE_ID_inodes,
+					       SPOS(0, inum.inum, snapshot),
+					       &buf.inode.k_i,
+					       sizeof(buf) / sizeof(u64) - 1))
+		return bkey_is_inode(&buf.inode.k)
+			? bch2_inode_unpack(bkey_i_to_s_c(&buf.inode.k_i), inode)
+			: -BCH_ERR_ENOENT_inode;
+
+	ret = __bch2_inode_peek(trans, &iter, inode, inum, snapshot, 0);
 	if (!ret)
 		bch2_trans_iter_exit(trans, &iter);
 	return ret;
 }
 
-int bch2_inode_find_by_inum_trans(struct btree_trans *trans,
+int bch2_inode_find_by_inum_nowarn_trans(struct btree_trans *trans,
 				  subvol_inum inum,
 				  struct bch_inode_unpacked *inode)
 {
-	struct btree_iter iter;
-	int ret;
+	return __bch2_inode_find_by_inum_trans(trans, inum, inode);
+}
 
-	ret = bch2_inode_peek(trans, &iter, inode, inum, 0);
-	if (!ret)
-		bch2_trans_iter_exit(trans, &iter);
+int bch2_inode_find_by_inum_trans(struct btree_trans *trans,
+				  subvol_inum inum,
+				  struct bch_inode_unpacked *inode)
+{
+	int ret = __bch2_inode_find_by_inum_trans(trans, inum, inode);
+	bch_err_msg(trans->c, ret, "looking up inum %u:%llu:", inum.subvol, inum.inum);
 	return ret;
 }
 
@@ -191,6 +191,14 @@ static int __do_six_trylock(struct six_lock *lock, enum six_lock_type type,
 			}
 		} while (!atomic_try_cmpxchg_acquire(&lock->state, &old, old + l[type].lock_val));
 
+		/*
+		 * The other ways of taking the write lock set the bit with a
+		 * full barrier; for six_lock_seq_read_retry() it must be
+		 * visible before anything written under the lock:
+		 */
+		if (ret > 0 && type == SIX_LOCK_write)
+			smp_wmb();
+
 		EBUG_ON(ret && !(atomic_read(&lock->state) & l[type].held_mask));
 	}
 
@@ -766,6 +774,52 @@ void six_lock_wakeup_all(struct six_lock *lock)
 }
 EXPORT_SYMBOL_GPL(six_lock_wakeup_all);
 
+/**
+ * six_lock_seq_read_begin - begin a lockless read of state protected by a lock
+ * @lock:	lock protecting the state to be read
+ * @seq:	returns the lock sequence number, for six_lock_seq_read_retry()
+ *
+ * This allows small pieces of state that are only modified with @lock held for
+ * write to be read without taking @lock at all, seqcount style: read the state,
+ * then call six_lock_seq_read_retry() to check that it wasn't modified while
+ * we were reading it. The caller is responsible for ensuring that the memory
+ * it reads stays allocated, e.g. with RCU.
+ *
+ * Return: false if @lock is currently held for write, in which case the caller
+ * must fall back to taking the lock.
+ */
+bool six_lock_seq_read_begin(struct six_lock *lock, u32 *seq)
+{
+	/*
+	 * seq is bumped before the write bit is cleared with release semantics
+	 * in six_unlock_ip(), so a clear bit here means a seq at least as new:
+	 */
+	*seq = smp_load_acquire(&lock->seq);
+	return !(atomic_read_acquire(&lock->state) & SIX_LOCK_HELD_write);
+}
+EXPORT_SYMBOL_GPL(six_lock_seq_read_begin);
+
+/**
+ * six_lock_seq_read_retry - check whether a lockless read raced with a writer
+ * @lock:	lock protecting the state that was read
+ * @seq:	sequence number from six_lock_seq_read_begin()
+ *
+ * Return: true if @lock was taken for write since six_lock_seq_read_begin(),
+ * meaning what was read may be inconsistent and must be discarded.
+ */
+bool six_lock_seq_read_retry(struct six_lock *lock, u32 seq)
+{
+	/*
+	 * Pairs with the barrier after setting the write bit when taking the
+	 * write lock: if we saw anything written under it, we see the bit, or
+	 * the seq bump of the unlock after it.
+	 */
+	smp_rmb();
+	return (atomic_read_acquire(&lock->state) & SIX_LOCK_HELD_write) ||
+		READ_ONCE(lock->seq) != seq;
+}
+EXPORT_SYMBOL_GPL(six_lock_seq_read_retry);
+
 /**
  * six_lock_counts - return held lock counts, for each lock type
  * @lock:	lock to return counters for
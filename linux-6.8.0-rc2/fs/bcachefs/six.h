@@ -380,6 +380,9 @@ struct six_lock_count {
 	unsigned n[3];
 };
 
+bool six_lock_seq_read_begin(struct six_lock *, u32 *);
+bool six_lock_seq_read_retry(struct six_lock *, u32);
+
 struct six_lock_count six_lock_counts(struct six_lock *);
 void six_lock_readers_add(struct six_lock *, int);
 
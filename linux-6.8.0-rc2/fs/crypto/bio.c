@@ -161,25 +161,24 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 		bio->bi_iter.bi_sector = sector;
 
 		i = 0;
-		offset = 0;
 		do {
-			err = fscrypt_crypt_data_unit(ci, FS_ENCRYPT, du_index,
-						      ZERO_PAGE(0), pages[i],
-						      du_size, offset,
-						      GFP_NOFS);
+			unsigned int nr_du = min_t(u64, du_per_page,
+						   du_remaining);
+
+			offset = nr_du << du_bits;
+			err = fscrypt_crypt_data_units(ci, FS_ENCRYPT, du_index,
+						       ZERO_PAGE(0), pages[i],
+						       du_size, offset, 0,
+						       GFP_NOFS);
 			if (err)
 				goto out;
-			du_index++;
-			sector += 1U << (du_bits - SECTOR_SHIFT);
-			du_remaining--;
-			offset += du_size;
-			if (offset == PAGE_SIZE || du_remaining == 0) {
-				ret = bio_add_page(bio, pages[i++], offset, 0);
-				if (WARN_ON_ONCE(ret != offset)) {
-					err = -EIO;
-					goto out;
-				}
-				offset = 0;
+			du_index += nr_du;
+			sector += (sector_t)nr_du << (du_bits - SECTOR_SHIFT);
+			du_remaining -= nr_du;
+			ret = bio_add_page(bio, pages[i++], offset, 0);
+			if (WARN_ON_ONCE(ret != offset)) {
+				err = -EIO;
+				goto out;
 			}
 		} while (i != nr_pages && du_remaining != 0);
 
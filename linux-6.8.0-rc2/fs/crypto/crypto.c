@@ -104,52 +104,141 @@ void fscrypt_generate_iv(union fscrypt_iv *iv, u64 index,
 	iv->index = cpu_to_le64(index);
 }
 
-/* Encrypt or decrypt a single "data unit" of file contents. */
-int fscrypt_crypt_data_unit(const struct fscrypt_inode_info *ci,
-			    fscrypt_direction_t rw, u64 index,
-			    struct page *src_page, struct page *dest_page,
-			    unsigned int len, unsigned int offs,
-			    gfp_t gfp_flags)
-{
+/* Maximum number of data units in flight in fscrypt_crypt_data_units() */
+#define FSCRYPT_DU_BATCH	8
+
+struct fscrypt_du_batch {
+	atomic_t pending;
+	int err;
+	struct completion done;
+};
+
+/* One data unit of a batch; the request context follows @req */
+struct fscrypt_du_req {
 	union fscrypt_iv iv;
-	struct skcipher_request *req = NULL;
-	DECLARE_CRYPTO_WAIT(wait);
-	struct scatterlist dst, src;
-	struct crypto_skcipher *tfm = ci->ci_enc_key.tfm;
-	int res = 0;
+	struct scatterlist src;
+	struct scatterlist dst;
+	struct skcipher_request req;
+};
 
-	if (WARN_ON_ONCE(len <= 0))
+static void fscrypt_du_done(void *data, int err)
+{
+	struct fscrypt_du_batch *batch = data;
+
+	/* a backlogged request was queued, it will complete later */
+	if (err == -EINPROGRESS)
+		return;
+	if (err)
+		cmpxchg(&batch->err, 0, err);
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->done);
+}
+
+/*
+ * Encrypt or decrypt the consecutive "data units" of file contents in the
+ * @len bytes at offset @offs of @src_page into @dest_page, starting with data
+ * unit @index.  @offs may go beyond the first page if the pages are physically
+ * contiguous, e.g. in a large folio.
+ *
+ * An skcipher request carries a single IV, so each data unit needs a request
+ * of its own.  Up to FSCRYPT_DU_BATCH of them are submitted before waiting,
+ * which lets asynchronous implementations (crypto engines, or cryptd when the
+ * FPU is unusable) work on a whole batch at once instead of completing one
+ * data unit per round trip.  Synchronous implementations still run one data
+ * unit per call.
+ */
+int fscrypt_crypt_data_units(const struct fscrypt_inode_info *ci,
+			     fscrypt_direction_t rw, u64 index,
+			     struct page *src_page, struct page *dest_page,
+			     unsigned int du_size, size_t len, size_t offs,
+			     gfp_t gfp_flags)
+{
+	struct crypto_skcipher *tfm = ci->ci_enc_key.tfm;
+	size_t reqsize = ALIGN(sizeof(struct fscrypt_du_req) +
+			       crypto_skcipher_reqsize(tfm), CRYPTO_MINALIGN);
+	struct fscrypt_du_batch batch;
+	struct fscrypt_du_req *dr;
+	size_t i = offs, end = offs + len;
+	unsigned int nr, n;
+	u64 first;
+	void *reqs;
+	int res;
+
+	if (WARN_ON_ONCE(du_size <= 0 || len <= 0))
 		return -EINVAL;
-	if (WARN_ON_ONCE(len % FSCRYPT_CONTENTS_ALIGNMENT != 0))
+	if (WARN_ON_ONCE(du_size % FSCRYPT_CONTENTS_ALIGNMENT != 0))
+		return -EINVAL;
+	if (WARN_ON_ONCE(len % du_size != 0))
 		return -EINVAL;
 
-	fscrypt_generate_iv(&iv, index, ci);
-
-	req = skcipher_request_alloc(tfm, gfp_flags);
-	if (!req)
+	nr = min_t(size_t, len / du_size, FSCRYPT_DU_BATCH);
+	reqs = kmalloc(nr * reqsize, gfp_flags | __GFP_NOWARN);
+	if (!reqs && nr > 1) {
+		/* a single data unit at a time is still fine */
+		nr = 1;
+		reqs = kmalloc(reqsize, gfp_flags);
+	}
+	if (!reqs)
 		return -ENOMEM;
 
-	skcipher_request_set_callback(
-		req, CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
-		crypto_req_done, &wait);
-
-	sg_init_table(&dst, 1);
-	sg_set_page(&dst, dest_page, len, offs);
-	sg_init_table(&src, 1);
-	sg_set_page(&src, src_page, len, offs);
-	skcipher_request_set_crypt(req, &src, &dst, len, &iv);
-	if (rw == FS_DECRYPT)
-		res = crypto_wait_req(crypto_skcipher_decrypt(req), &wait);
-	else
-		res = crypto_wait_req(crypto_skcipher_encrypt(req), &wait);
-	skcipher_request_free(req);
-	if (res) {
-		fscrypt_err(ci->ci_inode,
-			    "%scryption failed for data unit %llu: %d",
-			    (rw == FS_DECRYPT ? "De" : "En"), index, res);
-		return res;
+	init_completion(&batch.done);
+	batch.err = 0;
+	while (i < end) {
+		first = index;
+		reinit_completion(&batch.done);
+		/* held until the whole batch has been submitted */
+		atomic_set(&batch.pending, 1);
+
+		for (n = 0; n < nr && i < end; n++, i += du_size, index++) {
+			dr = reqs + n * reqsize;
+			fscrypt_generate_iv(&dr->iv, index, ci);
+			sg_init_table(&dr->src, 1);
+			sg_init_table(&dr->dst, 1);
+			sg_set_page(&dr->dst, nth_page(dest_page, i >> PAGE_SHIFT),
+				    du_size, i & ~PAGE_MASK);
+			sg_set_page(&dr->src, nth_page(src_page, i >> PAGE_SHIFT),
+				    du_size, i & ~PAGE_MASK);
+			skcipher_request_set_tfm(&dr->req, tfm);
+			skcipher_request_set_callback(&dr->req,
+						      CRYPTO_TFM_REQ_MAY_BACKLOG |
+						      CRYPTO_TFM_REQ_MAY_SLEEP,
+						      fscrypt_du_done, &batch);
+			skcipher_request_set_crypt(&dr->req, &dr->src, &dr->dst,
+						   du_size, &dr->iv);
+
+			atomic_inc(&batch.pending);
+			if (rw == FS_DECRYPT)
+				res = crypto_skcipher_decrypt(&dr->req);
+			else
+				res = crypto_skcipher_encrypt(&dr->req);
+			/* the callback is not called for synchronous results */
+			if (res != -EINPROGRESS && res != -EBUSY)
+				fscrypt_du_done(&batch, res);
+		}
+
+		fscrypt_du_done(&batch, 0);
+		wait_for_completion(&batch.done);
+		if (batch.err) {
+			fscrypt_err(ci->ci_inode,
+				    "%scryption failed for data units %llu-%llu: %d",
+				    (rw == FS_DECRYPT ? "De" : "En"), first,
+				    index - 1, batch.err);
+			break;
+		}
 	}
-	return 0;
+	kfree(reqs);
+	return batch.err;
+}
+
+/* Encrypt or decrypt a single "data unit" of file contents. */
+int fscrypt_crypt_data_unit(const struct fscrypt_inode_info *ci,
+			    fscrypt_direction_t rw, u64 index,
+			    struct page *src_page, struct page *dest_page,
+			    unsigned int len, unsigned int offs,
+			    gfp_t gfp_flags)
+{
+	return fscrypt_crypt_data_units(ci, rw, index, src_page, dest_page,
+					len, len, offs, gfp_flags);
 }
 
 /**
@@ -190,7 +279,6 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 	struct page *ciphertext_page;
 	u64 index = ((u64)page->index << (PAGE_SHIFT - du_bits)) +
 		    (offs >> du_bits);
-	unsigned int i;
 	int err;
 
 	if (WARN_ON_ONCE(!PageLocked(page)))
@@ -203,14 +291,12 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 	if (!ciphertext_page)
 		return ERR_PTR(-ENOMEM);
 
-	for (i = offs; i < offs + len; i += du_size, index++) {
-		err = fscrypt_crypt_data_unit(ci, FS_ENCRYPT, index,
-					      page, ciphertext_page,
-					      du_size, i, gfp_flags);
-		if (err) {
-			fscrypt_free_bounce_page(ciphertext_page);
-			return ERR_PTR(err);
-		}
+	err = fscrypt_crypt_data_units(ci, FS_ENCRYPT, index, page,
+				       ciphertext_page, du_size, len, offs,
+				       gfp_flags);
+	if (err) {
+		fscrypt_free_bounce_page(ciphertext_page);
+		return ERR_PTR(err);
 	}
 	SetPagePrivate(ciphertext_page);
 	set_page_private(ciphertext_page, (unsigned long)page);
@@ -272,8 +358,6 @@ int fscrypt_decrypt_pagecache_blocks(struct folio *folio, size_t len,
 	const unsigned int du_size = 1U << du_bits;
 	u64 index = ((u64)folio->index << (PAGE_SHIFT - du_bits)) +
 		    (offs >> du_bits);
-	size_t i;
-	int err;
 
 	if (WARN_ON_ONCE(!folio_test_locked(folio)))
 		return -EINVAL;
@@ -281,16 +365,10 @@ int fscrypt_decrypt_pagecache_blocks(struct folio *folio, size_t len,
 	if (WARN_ON_ONCE(len <= 0 || !IS_ALIGNED(len | offs, du_size)))
 		return -EINVAL;
 
-	for (i = offs; i < offs + len; i += du_size, index++) {
-		struct page *page = folio_page(folio, i >> PAGE_SHIFT);
-
-		err = fscrypt_crypt_data_unit(ci, FS_DECRYPT, index, page,
-					      page, du_size, i & ~PAGE_MASK,
-					      GFP_NOFS);
-		if (err)
-			return err;
-	}
-	return 0;
+	return fscrypt_crypt_data_units(ci, FS_DECRYPT, index,
+					folio_page(folio, 0),
+					folio_page(folio, 0), du_size, len,
+					offs, GFP_NOFS);
 }
 EXPORT_SYMBOL(fscrypt_decrypt_pagecache_blocks);
 
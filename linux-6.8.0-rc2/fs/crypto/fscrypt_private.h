@@ -296,6 +296,11 @@ typedef enum {
 /* crypto.c */
 extern struct kmem_cache *fscrypt_inode_info_cachep;
 int fscrypt_initialize(struct super_block *sb);
+int fscrypt_crypt_data_units(const struct fscrypt_inode_info *ci,
+			     fscrypt_direction_t rw, u64 index,
+			     struct page *src_page, struct page *dest_page,
+			     unsigned int du_size, size_t len, size_t offs,
+			     gfp_t gfp_flags);
 int fscrypt_crypt_data_unit(const struct fscrypt_inode_info *ci,
 			    fscrypt_direction_t rw, u64 index,
 			    struct page *src_page, struct page *dest_page,
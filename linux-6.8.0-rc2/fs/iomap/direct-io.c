@@ -20,6 +20,7 @@
  * Private flags for iomap_dio, must not overlap with the public ones in
  * iomap.h:
  */
+#define IOMAP_DIO_ONSTACK	(1U << 25)
 #define IOMAP_DIO_CALLER_COMP	(1U << 26)
 #define IOMAP_DIO_INLINE_COMP	(1U << 27)
 #define IOMAP_DIO_WRITE_THROUGH	(1U << 28)
@@ -58,9 +59,23 @@ static struct bio *iomap_dio_alloc_bio(const struct iomap_iter *iter,
 	if (dio->dops && dio->dops->bio_set)
 		return bio_alloc_bioset(iter->iomap.bdev, nr_vecs, opf,
 					GFP_KERNEL, dio->dops->bio_set);
+
+	/*
+	 * If the issuer allows it, recycle small bios through the per-cpu
+	 * cache of fs_bio_set instead of going back to the mempool for every
+	 * bio.  bio_alloc_bioset() ignores the flag for large vec counts.
+	 */
+	if (dio->iocb->ki_flags & IOCB_ALLOC_CACHE)
+		opf |= REQ_ALLOC_CACHE;
 	return bio_alloc(iter->iomap.bdev, nr_vecs, opf, GFP_KERNEL);
 }
 
+static inline void iomap_dio_free(struct iomap_dio *dio)
+{
+	if (!(dio->flags & IOMAP_DIO_ONSTACK))
+		kfree(dio);
+}
+
 static void iomap_dio_submit_bio(const struct iomap_iter *iter,
 		struct iomap_dio *dio, struct bio *bio, loff_t pos)
 {
@@ -128,7 +143,7 @@ ssize_t iomap_dio_complete(struct iomap_dio *dio)
 			ret += dio->done_before;
 	}
 	trace_iomap_dio_complete(iocb, dio->error, ret);
-	kfree(dio);
+	iomap_dio_free(dio);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(iomap_dio_complete);
@@ -536,10 +551,11 @@ static loff_t iomap_dio_iter(const struct iomap_iter *iter,
  * Returns -ENOTBLK In case of a page invalidation invalidation failure for
  * writes.  The callers needs to fall back to buffered I/O in this case.
  */
-struct iomap_dio *
-__iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
+static struct iomap_dio *
+iomap_dio_start(struct kiocb *iocb, struct iov_iter *iter,
 		const struct iomap_ops *ops, const struct iomap_dio_ops *dops,
-		unsigned int dio_flags, void *private, size_t done_before)
+		unsigned int dio_flags, void *private, size_t done_before,
+		struct iomap_dio *onstack)
 {
 	struct inode *inode = file_inode(iocb->ki_filp);
 	struct iomap_iter iomi = {
@@ -560,9 +576,15 @@ __iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 	if (!iomi.len)
 		return NULL;
 
-	dio = kmalloc(sizeof(*dio), GFP_KERNEL);
-	if (!dio)
-		return ERR_PTR(-ENOMEM);
+	if (onstack) {
+		dio = onstack;
+		dio->flags = IOMAP_DIO_ONSTACK;
+	} else {
+		dio = kmalloc(sizeof(*dio), GFP_KERNEL);
+		if (!dio)
+			return ERR_PTR(-ENOMEM);
+		dio->flags = 0;
+	}
 
 	dio->iocb = iocb;
 	atomic_set(&dio->ref, 1);
@@ -570,7 +592,6 @@ __iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 	dio->i_size = i_size_read(inode);
 	dio->dops = dops;
 	dio->error = 0;
-	dio->flags = 0;
 	dio->done_before = done_before;
 
 	dio->submit.iter = iter;
@@ -731,11 +752,20 @@ __iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 	return dio;
 
 out_free_dio:
-	kfree(dio);
+	iomap_dio_free(dio);
 	if (ret)
 		return ERR_PTR(ret);
 	return NULL;
 }
+
+struct iomap_dio *
+__iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
+		const struct iomap_ops *ops, const struct iomap_dio_ops *dops,
+		unsigned int dio_flags, void *private, size_t done_before)
+{
+	return iomap_dio_start(iocb, iter, ops, dops, dio_flags, private,
+			       done_before, NULL);
+}
 EXPORT_SYMBOL_GPL(__iomap_dio_rw);
 
 ssize_t
@@ -743,10 +773,19 @@ iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 		const struct iomap_ops *ops, const struct iomap_dio_ops *dops,
 		unsigned int dio_flags, void *private, size_t done_before)
 {
-	struct iomap_dio *dio;
+	struct iomap_dio onstack_dio, *dio;
 
-	dio = __iomap_dio_rw(iocb, iter, ops, dops, dio_flags, private,
-			     done_before);
+	/*
+	 * For synchronous I/O the submitter waits for all bios to complete
+	 * and then completes the dio itself before returning, so the per-I/O
+	 * state never outlives this function and can live on the stack.  This
+	 * keeps small synchronous reads and writes out of the allocator.
+	 */
+	dio = iomap_dio_start(iocb, iter, ops, dops, dio_flags, private,
+			      done_before,
+			      (is_sync_kiocb(iocb) ||
+			       (dio_flags & IOMAP_DIO_FORCE_WAIT)) ?
+					&onstack_dio : NULL);
 	if (IS_ERR_OR_NULL(dio))
 		return PTR_ERR_OR_ZERO(dio);
 	return iomap_dio_complete(dio);
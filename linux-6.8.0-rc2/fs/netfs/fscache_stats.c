@@ -38,6 +38,11 @@ atomic_t fscache_n_relinquishes_dropped;
 atomic_t fscache_n_resizes;
 atomic_t fscache_n_resizes_null;
 
+atomic_t fscache_n_write_batches;
+atomic_t fscache_n_write_merged;
+atomic_t fscache_n_write_throttled;
+atomic_t fscache_n_write_in_flight;
+
 atomic_t fscache_n_read;
 EXPORT_SYMBOL(fscache_n_read);
 atomic_t fscache_n_write;
@@ -99,5 +104,11 @@ int fscache_stats_show(struct seq_file *m)
 		   atomic_read(&fscache_n_read),
 		   atomic_read(&fscache_n_write),
 		   atomic_read(&fscache_n_dio_misfit));
+
+	seq_printf(m, "CopyWr : bat=%u mrg=%u thr=%u inf=%d\n",
+		   atomic_read(&fscache_n_write_batches),
+		   atomic_read(&fscache_n_write_merged),
+		   atomic_read(&fscache_n_write_throttled),
+		   atomic_read(&fscache_n_write_in_flight));
 	return 0;
 }
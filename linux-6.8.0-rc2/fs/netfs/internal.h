@@ -295,6 +295,11 @@ extern atomic_t fscache_n_relinquishes_dropped;
 extern atomic_t fscache_n_resizes;
 extern atomic_t fscache_n_resizes_null;
 
+extern atomic_t fscache_n_write_batches;
+extern atomic_t fscache_n_write_merged;
+extern atomic_t fscache_n_write_throttled;
+extern atomic_t fscache_n_write_in_flight;
+
 static inline void fscache_stat(atomic_t *stat)
 {
 	atomic_inc(stat);
@@ -12,10 +12,32 @@
 #include <linux/pagemap.h>
 #include <linux/slab.h>
 #include <linux/uio.h>
+#include <linux/blkdev.h>
+#include <linux/wait_bit.h>
 #include <linux/sched/mm.h>
 #include <linux/task_io_accounting_ops.h>
 #include "internal.h"
 
+/*
+ * Limit on the number of writes of downloaded data to each cache that may be
+ * in flight at once.  Readers of cold files can otherwise queue up writes
+ * faster than the cache backing device can absorb them.  0 means no limit.
+ */
+static unsigned int netfs_cache_write_max_in_flight = 64;
+module_param_named(cache_write_max_in_flight, netfs_cache_write_max_in_flight,
+		   uint, 0644);
+MODULE_PARM_DESC(cache_write_max_in_flight,
+		 "Maximum number of copy-to-cache writes in flight per cache");
+
+/*
+ * Get the cache that a request's data is copied to.  The request's cache
+ * resources keep it pinned until all its writes have completed.
+ */
+static struct fscache_cache *netfs_rreq_cache(struct netfs_io_request *rreq)
+{
+	return netfs_i_cookie(netfs_inode(rreq->inode))->volume->cache;
+}
+
 /*
  * Clear the unread part of an I/O request.
  */
@@ -142,6 +164,13 @@ static void netfs_rreq_copy_terminated(void *priv, ssize_t transferred_or_error,
 {
 	struct netfs_io_subrequest *subreq = priv;
 	struct netfs_io_request *rreq = subreq->rreq;
+	struct fscache_cache *cache = netfs_rreq_cache(rreq);
+
+	fscache_stat_d(&fscache_n_write_in_flight);
+	/* The limit may have changed, so always let waiters recheck it */
+	atomic_dec(&cache->n_writes_in_flight);
+	smp_mb__after_atomic();
+	wake_up_var(&cache->n_writes_in_flight);
 
 	if (IS_ERR_VALUE(transferred_or_error)) {
 		netfs_stat(&netfs_n_rh_write_failed);
@@ -160,15 +189,49 @@ static void netfs_rreq_copy_terminated(void *priv, ssize_t transferred_or_error,
 	netfs_put_subrequest(subreq, was_async, netfs_sreq_trace_put_terminated);
 }
 
+/*
+ * Take a slot for a write to the cache, waiting for writes already in flight
+ * to complete if there are too many.  The submission plug is flushed before
+ * we sleep so that the writes we're waiting for are actually issued.
+ */
+static bool netfs_cache_write_slot_free(struct fscache_cache *cache)
+{
+	unsigned int max = READ_ONCE(netfs_cache_write_max_in_flight);
+
+	return !max || atomic_read(&cache->n_writes_in_flight) < max;
+}
+
+static void netfs_begin_cache_write(struct fscache_cache *cache,
+				    struct blk_plug *plug)
+{
+	if (!netfs_cache_write_slot_free(cache)) {
+		fscache_stat(&fscache_n_write_throttled);
+		blk_finish_plug(plug);
+		wait_var_event(&cache->n_writes_in_flight,
+			       netfs_cache_write_slot_free(cache));
+		blk_start_plug(plug);
+	}
+
+	atomic_inc(&cache->n_writes_in_flight);
+	fscache_stat(&fscache_n_write_in_flight);
+}
+
 /*
  * Perform any outstanding writes to the cache.  We inherit a ref from the
  * caller.
+ *
+ * Contiguous subrequests are merged into single writes and the writes are
+ * issued asynchronously under a plug so that the cache backing device sees
+ * them as a batch.
  */
 static void netfs_rreq_do_write_to_cache(struct netfs_io_request *rreq)
 {
 	struct netfs_cache_resources *cres = &rreq->cache_resources;
+	struct fscache_cache *cache = netfs_rreq_cache(rreq);
 	struct netfs_io_subrequest *subreq, *next, *p;
 	struct iov_iter iter;
+	struct blk_plug plug;
+	unsigned int nr_writes = 0;
 	int ret;
 
 	trace_netfs_rreq(rreq, netfs_rreq_trace_copy);
@@ -186,6 +249,8 @@ static void netfs_rreq_do_write_to_cache(struct netfs_io_request *rreq)
 		}
 	}
 
+	blk_start_plug(&plug);
+
 	list_for_each_entry(subreq, &rreq->subrequests, rreq_link) {
 		/* Amalgamate adjacent writes */
 		while (!list_is_last(&subreq->rreq_link, &rreq->subrequests)) {
@@ -194,6 +259,7 @@ static void netfs_rreq_do_write_to_cache(struct netfs_io_request *rreq)
 				break;
 			subreq->len += next->len;
 			list_del_init(&next->rreq_link);
+			fscache_stat(&fscache_n_write_merged);
 			netfs_put_subrequest(next, false,
 					     netfs_sreq_trace_put_merged);
 		}
@@ -209,14 +275,20 @@ static void netfs_rreq_do_write_to_cache(struct netfs_io_request *rreq)
 		iov_iter_xarray(&iter, ITER_SOURCE, &rreq->mapping->i_pages,
 				subreq->start, subreq->len);
 
+		netfs_begin_cache_write(cache, &plug);
 		atomic_inc(&rreq->nr_copy_ops);
 		netfs_stat(&netfs_n_rh_write);
 		netfs_get_subrequest(subreq, netfs_sreq_trace_get_copy_to_cache);
 		trace_netfs_sreq(subreq, netfs_sreq_trace_write);
 		cres->ops->write(cres, subreq->start, &iter,
 				 netfs_rreq_copy_terminated, subreq);
+		nr_writes++;
 	}
 
+	blk_finish_plug(&plug);
+	if (nr_writes)
+		fscache_stat(&fscache_n_write_batches);
+
 	/* If we decrement nr_copy_ops to 0, the usage ref belongs to us. */
 	if (atomic_dec_and_test(&rreq->nr_copy_ops))
 		netfs_rreq_unmark_after_write(rreq, false);
@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Helpers shared by the NFS client and server for the LOCALIO
+ * auxiliary protocol.
+ */
+
+#include <linux/module.h>
+#include <linux/rculist.h>
+#include <linux/nfslocalio.h>
+#include <net/netns/generic.h>
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("NFS localio protocol bypass support");
+
+static DEFINE_SPINLOCK(nfs_uuid_lock);
+
+/*
+ * Global list of nfs_uuid_t instances
+ * that is protected by nfs_uuid_lock.
+ */
+static LIST_HEAD(nfs_uuids);
+
+/**
+ * nfs_uuid_begin - start a LOCALIO handshake
+ * @nfs_uuid: client-owned handshake state
+ *
+ * Generate a fresh UUID and publish it so that a server in the same
+ * kernel can find it when the client sends it in a UUID_IS_LOCAL call.
+ */
+void nfs_uuid_begin(nfs_uuid_t *nfs_uuid)
+{
+	nfs_uuid->net = NULL;
+	nfs_uuid->dom = NULL;
+	uuid_gen(&nfs_uuid->uuid);
+
+	spin_lock(&nfs_uuid_lock);
+	list_add_tail(&nfs_uuid->list, &nfs_uuids);
+	spin_unlock(&nfs_uuid_lock);
+}
+EXPORT_SYMBOL_GPL(nfs_uuid_begin);
+
+/**
+ * nfs_uuid_end - finish a LOCALIO handshake
+ * @nfs_uuid: client-owned handshake state
+ *
+ * If no server claimed @nfs_uuid, withdraw it from the global list.
+ */
+void nfs_uuid_end(nfs_uuid_t *nfs_uuid)
+{
+	if (nfs_uuid->net == NULL) {
+		spin_lock(&nfs_uuid_lock);
+		if (nfs_uuid->net == NULL)
+			list_del_init(&nfs_uuid->list);
+		spin_unlock(&nfs_uuid_lock);
+	}
+}
+EXPORT_SYMBOL_GPL(nfs_uuid_end);
+
+static nfs_uuid_t *nfs_uuid_lookup_locked(const uuid_t *uuid)
+{
+	nfs_uuid_t *nfs_uuid;
+
+	list_for_each_entry(nfs_uuid, &nfs_uuids, list)
+		if (uuid_equal(&nfs_uuid->uuid, uuid))
+			return nfs_uuid;
+
+	return NULL;
+}
+
+static struct module *nfsd_mod;
+
+/**
+ * nfs_uuid_is_local - claim a client's UUID for this server
+ * @uuid: UUID received in a UUID_IS_LOCAL call
+ * @list: per-net list of the server's local clients
+ * @net: the server's network namespace
+ * @dom: auth_domain of the client that sent @uuid
+ * @mod: the server module, pinned while the client stays local
+ *
+ * If @uuid was generated by a client in this kernel, record the
+ * server's @net and @dom in it so the client can open files directly.
+ */
+void nfs_uuid_is_local(const uuid_t *uuid, struct list_head *list,
+		       struct net *net, struct auth_domain *dom,
+		       struct module *mod)
+{
+	nfs_uuid_t *nfs_uuid;
+
+	spin_lock(&nfs_uuid_lock);
+	nfs_uuid = nfs_uuid_lookup_locked(uuid);
+	if (nfs_uuid) {
+		kref_get(&dom->ref);
+		nfs_uuid->dom = dom;
+		/*
+		 * We don't hold a ref on the net, but instead put
+		 * ourselves on a list so the net pointer can be
+		 * invalidated.
+		 */
+		list_move(&nfs_uuid->list, list);
+		rcu_assign_pointer(nfs_uuid->net, net);
+
+		__module_get(mod);
+		nfsd_mod = mod;
+	}
+	spin_unlock(&nfs_uuid_lock);
+}
+EXPORT_SYMBOL_GPL(nfs_uuid_is_local);
+
+static void nfs_uuid_put_locked(nfs_uuid_t *nfs_uuid)
+{
+	if (nfs_uuid->net) {
+		module_put(nfsd_mod);
+		RCU_INIT_POINTER(nfs_uuid->net, NULL);
+	}
+	if (nfs_uuid->dom) {
+		auth_domain_put(nfs_uuid->dom);
+		WRITE_ONCE(nfs_uuid->dom, NULL);
+	}
+	list_del_init(&nfs_uuid->list);
+}
+
+/**
+ * nfs_uuid_invalidate_clients - forget every local client on @list
+ * @list: per-net list of the server's local clients
+ *
+ * Called by the server when it shuts down a network namespace.
+ */
+void nfs_uuid_invalidate_clients(struct list_head *list)
+{
+	nfs_uuid_t *nfs_uuid, *tmp;
+
+	spin_lock(&nfs_uuid_lock);
+	list_for_each_entry_safe(nfs_uuid, tmp, list, list)
+		nfs_uuid_put_locked(nfs_uuid);
+	spin_unlock(&nfs_uuid_lock);
+}
+EXPORT_SYMBOL_GPL(nfs_uuid_invalidate_clients);
+
+/**
+ * nfs_uuid_invalidate_one_client - stop using LOCALIO for one client
+ * @nfs_uuid: client-owned handshake state
+ *
+ * Called by the client when it is torn down or loses its server.
+ */
+void nfs_uuid_invalidate_one_client(nfs_uuid_t *nfs_uuid)
+{
+	if (nfs_uuid->net) {
+		spin_lock(&nfs_uuid_lock);
+		nfs_uuid_put_locked(nfs_uuid);
+		spin_unlock(&nfs_uuid_lock);
+	}
+}
+EXPORT_SYMBOL_GPL(nfs_uuid_invalidate_one_client);
+
+/**
+ * nfs_open_local_fh - open a file on a local server, bypassing RPC
+ * @uuid: handshake state claimed by the server
+ * @rpc_clnt: the client's RPC client for this server
+ * @cred: credential of the user doing the I/O
+ * @nfs_fh: filehandle of the file to open
+ * @fmode: FMODE_READ and/or FMODE_WRITE
+ *
+ * Returns an nfsd_file holding a reference on the server, to be
+ * released with nfs_to_nfsd_file_put_local(), or an ERR_PTR.  The
+ * server applies its normal export and permission checks.
+ */
+struct nfsd_file *nfs_open_local_fh(nfs_uuid_t *uuid,
+		   struct rpc_clnt *rpc_clnt, const struct cred *cred,
+		   const struct nfs_fh *nfs_fh, const fmode_t fmode)
+{
+	struct auth_domain *dom;
+	struct nfsd_file *localio;
+	struct net *net;
+
+	/*
+	 * Not running in nfsd context, so must safely get reference on
+	 * the server.  uuid->net is NOT a counted reference, but
+	 * rcu_read_lock() ensures that if uuid->net is not NULL, then
+	 * calling nfsd_serv_try_get() is safe and if it succeeds we will
+	 * have an implied reference to the net.  auth_domains are freed
+	 * via RCU, so the same applies to uuid->dom.
+	 */
+	rcu_read_lock();
+	net = rcu_dereference(uuid->net);
+	dom = READ_ONCE(uuid->dom);
+	if (!net || !dom || !kref_get_unless_zero(&dom->ref)) {
+		rcu_read_unlock();
+		return ERR_PTR(-ENXIO);
+	}
+	if (!nfs_to->nfsd_serv_try_get(net)) {
+		rcu_read_unlock();
+		auth_domain_put(dom);
+		return ERR_PTR(-ENXIO);
+	}
+	rcu_read_unlock();
+
+	localio = nfs_to->nfsd_open_local_fh(net, dom, rpc_clnt,
+					     cred, nfs_fh, fmode);
+	if (IS_ERR(localio))
+		nfs_to->nfsd_serv_put(net);
+	auth_domain_put(dom);
+	return localio;
+}
+EXPORT_SYMBOL_GPL(nfs_open_local_fh);
+
+/*
+ * The NFS LOCALIO code needs to call into NFSD using various symbols,
+ * but cannot be statically linked, because that will make the NFS
+ * module always depend on the NFSD module.
+ *
+ * 'nfs_to' provides NFS access to NFSD functions needed for LOCALIO.
+ * Any successful client<->server LOCALIO handshake takes a reference
+ * on the NFSD module (see nfs_uuid_is_local), so the operations
+ * cannot disappear while a client may still call them.  If NFSD is
+ * not loaded, no handshake can succeed and 'nfs_to' is never used.
+ */
+const struct nfsd_localio_operations *nfs_to;
+EXPORT_SYMBOL_GPL(nfs_to);
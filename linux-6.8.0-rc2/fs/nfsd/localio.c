@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * NFS server support for local clients to bypass network stack
+ *
+ * An NFS client mounting a server in the same kernel proves that it is
+ * local by sending a UUID it generated over the LOCALIO auxiliary RPC
+ * program.  Once the server has claimed that UUID, the client can use
+ * nfsd_open_local_fh() to get an nfsd_file for a filehandle and issue
+ * READ, WRITE and COMMIT directly against the underlying file.
+ */
+
+#include <linux/exportfs.h>
+#include <linux/sunrpc/svcauth.h>
+#include <linux/sunrpc/clnt.h>
+#include <linux/nfs.h>
+#include <linux/nfslocalio.h>
+#include <linux/string.h>
+
+#include "nfsd.h"
+#include "vfs.h"
+#include "netns.h"
+#include "filecache.h"
+#include "cache.h"
+
+#define NFSDDBG_FACILITY		NFSDDBG_FH
+
+struct localio_uuidarg {
+	uuid_t			uuid;
+};
+
+static int nfsd_localio_errno(__be32 status)
+{
+	switch (be32_to_cpu(status)) {
+	case NFSERR_PERM:
+		return -EPERM;
+	case NFSERR_ACCES:
+	case NFSERR_WRONGSEC:
+		return -EACCES;
+	case NFSERR_ROFS:
+		return -EROFS;
+	case NFSERR_STALE:
+	case NFSERR_BADHANDLE:
+		return -ESTALE;
+	case NFSERR_JUKEBOX:
+		return -EAGAIN;
+	case NFSERR_ISDIR:
+		return -EISDIR;
+	case NFSERR_INVAL:
+		return -EINVAL;
+	}
+	return -EIO;
+}
+
+/**
+ * nfsd_open_local_fh - lookup a local filehandle @nfs_fh and map to nfsd_file
+ *
+ * @net: 'struct net' to get the proper nfsd_net required for LOCALIO access
+ * @dom: 'struct auth_domain' required for LOCALIO access
+ * @rpc_clnt: rpc_clnt that the client established
+ * @cred: cred that the client established
+ * @nfs_fh: filehandle to lookup
+ * @fmode: fmode_t to use for open
+ *
+ * This function maps a local fh to a path on a local filesystem.
+ * This is useful when the nfs client has the local server mounted - it can
+ * avoid all the NFS overhead with reads, writes and commits.
+ *
+ * On successful return, returned nfsd_file will have its nf_net member
+ * set. Caller (NFS client) is responsible for calling nfsd_serv_put and
+ * nfsd_file_put (via nfs_to_nfsd_file_put_local).
+ */
+static struct nfsd_file *
+nfsd_open_local_fh(struct net *net, struct auth_domain *dom,
+		   struct rpc_clnt *rpc_clnt, const struct cred *cred,
+		   const struct nfs_fh *nfs_fh, const fmode_t fmode)
+{
+	int mayflags = 0;
+	struct svc_cred rq_cred;
+	struct svc_fh fh;
+	struct nfsd_file *localio;
+	__be32 beres;
+
+	if (nfs_fh->size > NFS4_FHSIZE)
+		return ERR_PTR(-EINVAL);
+
+	/* nfs_fh -> svc_fh */
+	fh_init(&fh, NFS4_FHSIZE);
+	fh.fh_handle.fh_size = nfs_fh->size;
+	memcpy(fh.fh_handle.fh_raw, nfs_fh->data, nfs_fh->size);
+
+	if (fmode & FMODE_READ)
+		mayflags |= NFSD_MAY_READ;
+	if (fmode & FMODE_WRITE)
+		mayflags |= NFSD_MAY_WRITE;
+
+	svcauth_map_clnt_to_svc_cred_local(rpc_clnt, cred, &rq_cred);
+
+	beres = nfsd_file_acquire_local(net, &rq_cred, dom,
+					&fh, mayflags, &localio);
+	if (beres)
+		localio = ERR_PTR(nfsd_localio_errno(beres));
+
+	fh_put(&fh);
+	free_svc_cred(&rq_cred);
+
+	return localio;
+}
+
+static bool nfsd_serv_try_get(struct net *net)
+{
+	struct nfsd_net *nn = net_generic(net, nfsd_net_id);
+
+	return percpu_ref_tryget_live(&nn->nfsd_serv_ref);
+}
+
+static void nfsd_serv_put(struct net *net)
+{
+	struct nfsd_net *nn = net_generic(net, nfsd_net_id);
+
+	percpu_ref_put(&nn->nfsd_serv_ref);
+}
+
+/*
+ * Drop both the file reference and the server reference that
+ * nfs_open_local_fh() handed to the client.
+ */
+static void nfsd_file_put_local(struct nfsd_file *nf)
+{
+	struct net *net = nf->nf_net;
+
+	nfsd_file_put(nf);
+	nfsd_serv_put(net);
+}
+
+static struct file *nfsd_file_file(struct nfsd_file *nf)
+{
+	return nf->nf_file;
+}
+
+static const struct nfsd_localio_operations nfsd_localio_ops = {
+	.nfsd_serv_try_get	= nfsd_serv_try_get,
+	.nfsd_serv_put		= nfsd_serv_put,
+	.nfsd_open_local_fh	= nfsd_open_local_fh,
+	.nfsd_file_put_local	= nfsd_file_put_local,
+	.nfsd_file_file		= nfsd_file_file,
+};
+
+void nfsd_localio_ops_init(void)
+{
+	nfs_to = &nfsd_localio_ops;
+}
+
+/**
+ * nfsd_localio_init - module-wide LOCALIO setup
+ */
+void nfsd_localio_init(void)
+{
+	nfsd_localio_ops_init();
+}
+
+static void nfsd_serv_free(struct percpu_ref *ref)
+{
+	struct nfsd_net *nn = container_of(ref, struct nfsd_net, nfsd_serv_ref);
+
+	complete(&nn->nfsd_serv_free_done);
+}
+
+/**
+ * nfsd_localio_net_init - set up LOCALIO state for a new namespace
+ * @nn: the nfsd_net being initialised
+ *
+ * The server reference starts out dead; it only comes alive while
+ * nfsd is running in this namespace.
+ */
+int nfsd_localio_net_init(struct nfsd_net *nn)
+{
+	INIT_LIST_HEAD(&nn->local_clients);
+	init_completion(&nn->nfsd_serv_free_done);
+	return percpu_ref_init(&nn->nfsd_serv_ref, nfsd_serv_free,
+			       PERCPU_REF_INIT_DEAD, GFP_KERNEL);
+}
+
+/**
+ * nfsd_localio_net_exit - release LOCALIO state of a namespace
+ * @nn: the nfsd_net being destroyed
+ */
+void nfsd_localio_net_exit(struct nfsd_net *nn)
+{
+	percpu_ref_exit(&nn->nfsd_serv_ref);
+}
+
+/**
+ * nfsd_localio_startup_net - allow LOCALIO opens in a namespace
+ * @nn: the nfsd_net being started
+ */
+void nfsd_localio_startup_net(struct nfsd_net *nn)
+{
+	reinit_completion(&nn->nfsd_serv_free_done);
+	percpu_ref_reinit(&nn->nfsd_serv_ref);
+}
+
+/**
+ * nfsd_localio_shutdown_net - stop serving LOCALIO in a namespace
+ * @nn: the nfsd_net being shut down
+ *
+ * Forget every client that proved it is local, so no new local opens
+ * can start, then wait for the clients to drop the files they still
+ * hold open.
+ */
+void nfsd_localio_shutdown_net(struct nfsd_net *nn)
+{
+	nfs_uuid_invalidate_clients(&nn->local_clients);
+
+	percpu_ref_kill(&nn->nfsd_serv_ref);
+	wait_for_completion(&nn->nfsd_serv_free_done);
+}
+
+/*
+ * UUID_IS_LOCAL XDR functions
+ */
+
+static bool
+localio_decode_uuidarg(struct svc_rqst *rqstp, struct xdr_stream *xdr)
+{
+	struct localio_uuidarg *argp = rqstp->rq_argp;
+	u8 uuid[UUID_SIZE];
+
+	if (xdr_stream_decode_opaque_fixed(xdr, uuid, UUID_SIZE) < 0)
+		return false;
+	import_uuid(&argp->uuid, uuid);
+
+	return true;
+}
+
+static __be32 localio_proc_null(struct svc_rqst *rqstp)
+{
+	return rpc_success;
+}
+
+static __be32 localio_proc_uuid_is_local(struct svc_rqst *rqstp)
+{
+	struct localio_uuidarg *argp = rqstp->rq_argp;
+	struct net *net = SVC_NET(rqstp);
+	struct nfsd_net *nn = net_generic(net, nfsd_net_id);
+
+	/* Clients without any export to this server cannot use LOCALIO */
+	if (rqstp->rq_client)
+		nfs_uuid_is_local(&argp->uuid, &nn->local_clients,
+				  net, rqstp->rq_client, THIS_MODULE);
+
+	return rpc_success;
+}
+
+static const struct svc_procedure localio_procedures1[] = {
+	[LOCALIOPROC_NULL] = {
+		.pc_func = localio_proc_null,
+		.pc_decode = nfssvc_decode_voidarg,
+		.pc_encode = nfssvc_encode_voidres,
+		.pc_argsize = sizeof(struct nfsd_voidargs),
+		.pc_ressize = sizeof(struct nfsd_voidres),
+		.pc_cachetype = RC_NOCACHE,
+		.pc_xdrressize = 0,
+		.pc_name = "NULL",
+	},
+	[LOCALIOPROC_UUID_IS_LOCAL] = {
+		.pc_func = localio_proc_uuid_is_local,
+		.pc_decode = localio_decode_uuidarg,
+		.pc_encode = nfssvc_encode_voidres,
+		.pc_argsize = sizeof(struct localio_uuidarg),
+		.pc_argzero = sizeof(struct localio_uuidarg),
+		.pc_ressize = sizeof(struct nfsd_voidres),
+		.pc_cachetype = RC_NOCACHE,
+		.pc_name = "UUID_IS_LOCAL",
+	},
+};
+
+#define LOCALIO_NR_PROCEDURES ARRAY_SIZE(localio_procedures1)
+static DEFINE_PER_CPU_ALIGNED(unsigned long,
+			      localio_count[LOCALIO_NR_PROCEDURES]);
+static const struct svc_version localio_version1 = {
+	.vs_vers	= LOCALIO_V1,
+	.vs_nproc	= LOCALIO_NR_PROCEDURES,
+	.vs_proc	= localio_procedures1,
+	.vs_dispatch	= nfsd_dispatch,
+	.vs_count	= localio_count,
+	.vs_xdrsize	= XDR_QUADLEN(UUID_SIZE),
+	.vs_hidden	= true,
+};
+
+#define LOCALIO_NR_VERSIONS 2
+static const struct svc_version *nfsd_localio_version[LOCALIO_NR_VERSIONS] = {
+	[LOCALIO_V1] = &localio_version1,
+};
+
+/*
+ * LOCALIO is negotiated on the transport the client already uses for
+ * NFS, so it is never advertised through rpcbind.
+ */
+static int
+nfsd_localio_rpcbind_set(struct net *net, const struct svc_program *progp,
+			 u32 version, int family, unsigned short proto,
+			 unsigned short port)
+{
+	return 0;
+}
+
+struct svc_program nfsd_localio_program = {
+	.pg_prog		= NFS_LOCALIO_PROGRAM,
+	.pg_nvers		= LOCALIO_NR_VERSIONS,
+	.pg_vers		= nfsd_localio_version,
+	.pg_name		= "nfslocalio",
+	.pg_class		= "nfsd",
+	.pg_authenticate	= &svc_set_client,
+	.pg_init_request	= svc_generic_init_request,
+	.pg_rpcbind_set		= nfsd_localio_rpcbind_set,
+};
@@ -12,6 +12,7 @@
 #include <net/netns/generic.h>
 #include <linux/filelock.h>
 #include <linux/percpu_counter.h>
+#include <linux/percpu-refcount.h>
 #include <linux/siphash.h>
 
 /* Hash tables for nfs4_clientid state */
@@ -119,6 +120,12 @@ struct nfsd_net {
 	 */
 	unsigned int max_connections;
 
+	/*
+	 * Max number of threads nfsd may start on demand. Defaults to '0',
+	 * which keeps the number of threads fixed.
+	 */
+	unsigned int max_threads;
+
 	u32 clientid_base;
 	u32 clientid_counter;
 	u32 clverifier_counter;
@@ -192,6 +199,14 @@ struct nfsd_net {
 	atomic_t		nfsd_courtesy_clients;
 	struct shrinker		*nfsd_client_shrinker;
 	struct work_struct	nfsd_shrinker_work;
+
+#ifdef CONFIG_NFSD_LOCALIO
+	/* Local clients to be invalidated when net is shut down */
+	struct list_head	local_clients;
+	/* Held by each LOCALIO open; live only while nfsd runs */
+	struct percpu_ref	nfsd_serv_ref;
+	struct completion	nfsd_serv_free_done;
+#endif
 };
 
 /* Simple check to find out if a given net was properly initialized */
@@ -143,6 +143,24 @@ extern const struct svc_version nfsd_acl_version3;
 
 struct nfsd_net;
 
+#ifdef CONFIG_NFSD_LOCALIO
+extern struct svc_program	nfsd_localio_program;
+int		nfsd_localio_net_init(struct nfsd_net *nn);
+void		nfsd_localio_net_exit(struct nfsd_net *nn);
+void		nfsd_localio_startup_net(struct nfsd_net *nn);
+void		nfsd_localio_shutdown_net(struct nfsd_net *nn);
+void		nfsd_localio_init(void);
+#else
+static inline int nfsd_localio_net_init(struct nfsd_net *nn)
+{
+	return 0;
+}
+static inline void nfsd_localio_net_exit(struct nfsd_net *nn) { }
+static inline void nfsd_localio_startup_net(struct nfsd_net *nn) { }
+static inline void nfsd_localio_shutdown_net(struct nfsd_net *nn) { }
+static inline void nfsd_localio_init(void) { }
+#endif
+
 enum vers_op {NFSD_SET, NFSD_CLEAR, NFSD_TEST, NFSD_AVAIL };
 int nfsd_vers(struct nfsd_net *nn, int vers, enum vers_op change);
 int nfsd_minorversion(struct nfsd_net *nn, u32 minorversion, enum vers_op change);
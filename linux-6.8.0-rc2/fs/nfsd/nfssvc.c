@@ -94,6 +94,9 @@ static const struct svc_version *nfsd_acl_version[] = {
 #define NFSD_ACL_NRVERS		ARRAY_SIZE(nfsd_acl_version)
 
 static struct svc_program	nfsd_acl_program = {
+#ifdef CONFIG_NFSD_LOCALIO
+	.pg_next		= &nfsd_localio_program,
+#endif
 	.pg_prog		= NFS_ACL_PROGRAM,
 	.pg_nvers		= NFSD_ACL_NRVERS,
 	.pg_vers		= nfsd_acl_version,
@@ -126,6 +129,8 @@ static const struct svc_version *nfsd_version[] = {
 struct svc_program		nfsd_program = {
 #if defined(CONFIG_NFSD_V2_ACL) || defined(CONFIG_NFSD_V3_ACL)
 	.pg_next		= &nfsd_acl_program,
+#elif defined(CONFIG_NFSD_LOCALIO)
+	.pg_next		= &nfsd_localio_program,
 #endif
 	.pg_prog		= NFS_PROGRAM,		/* program number */
 	.pg_nvers		= NFSD_NRVERS,		/* nr of entries in nfsd_version */
@@ -434,6 +439,7 @@ static int nfsd_startup_net(struct net *net, const struct cred *cred)
 #ifdef CONFIG_NFSD_V4_2_INTER_SSC
 	nfsd4_ssc_init_umount_work(nn);
 #endif
+	nfsd_localio_startup_net(nn);
 	nn->nfsd_net_up = true;
 	return 0;
 
@@ -455,6 +461,7 @@ static void nfsd_shutdown_net(struct net *net)
 {
 	struct nfsd_net *nn = net_generic(net, nfsd_net_id);
 
+	nfsd_localio_shutdown_net(nn);
 	nfs4_state_shutdown_net(net);
 	nfsd_reply_cache_shutdown(nn);
 	nfsd_file_cache_shutdown_net(net);
@@ -671,6 +678,7 @@ int nfsd_create_serv(struct net *net)
 		return -ENOMEM;
 
 	serv->sv_maxconn = nn->max_connections;
+	serv->sv_nrthrmax = nn->max_threads;
 	error = svc_bind(serv, net);
 	if (error < 0) {
 		svc_destroy(&serv);
@@ -66,6 +66,7 @@ struct ksmbd_conn *ksmbd_conn_alloc(void)
 		conn->um = ERR_PTR(-EOPNOTSUPP);
 	if (IS_ERR(conn->um))
 		conn->um = NULL;
+	conn->work_cpu = WORK_CPU_UNBOUND;
 	atomic_set(&conn->req_running, 0);
 	atomic_set(&conn->r_count, 0);
 	conn->total_credits = 1;
@@ -187,11 +188,18 @@ int ksmbd_conn_write(struct ksmbd_work *work)
 		return -EINVAL;
 
 	ksmbd_conn_lock(conn);
-	sent = conn->transport->ops->writev(conn->transport, work->iov,
-			work->iov_cnt,
-			get_rfc1002_len(work->iov[0].iov_base) + 4,
-			work->need_invalidate_rkey,
-			work->remote_key);
+	if (work->splice_iov_idx && conn->transport->ops->writev_pages)
+		sent = conn->transport->ops->writev_pages(conn->transport,
+				work->iov, work->iov_cnt,
+				get_rfc1002_len(work->iov[0].iov_base) + 4,
+				work->splice_iov_idx,
+				work->splice_bvec, work->splice_nr_bvec);
+	else
+		sent = conn->transport->ops->writev(conn->transport, work->iov,
+				work->iov_cnt,
+				get_rfc1002_len(work->iov[0].iov_base) + 4,
+				work->need_invalidate_rkey,
+				work->remote_key);
 	ksmbd_conn_unlock(conn);
 
 	if (sent < 0) {
@@ -54,6 +54,8 @@ struct ksmbd_conn {
 	/* smb session 1 per user */
 	struct xarray			sessions;
 	unsigned long			last_active;
+	/* CPU that runs the works of this connection, or WORK_CPU_UNBOUND */
+	int				work_cpu;
 	/* How many request are running currently */
 	atomic_t			req_running;
 	/* References which are made for this Server object*/
@@ -122,6 +124,13 @@ struct ksmbd_transport_ops {
 	int (*writev)(struct ksmbd_transport *t, struct kvec *iovs, int niov,
 		      int size, bool need_invalidate_rkey,
 		      unsigned int remote_key);
+	/*
+	 * Like writev, but iovs[page_idx] onwards describe the nr_bvec
+	 * pages in bvec, which can be sent without copying them.
+	 */
+	int (*writev_pages)(struct ksmbd_transport *t, struct kvec *iovs,
+			    int niov, int size, int page_idx,
+			    struct bio_vec *bvec, int nr_bvec);
 	int (*rdma_read)(struct ksmbd_transport *t,
 			 void *buf, unsigned int len,
 			 struct smb2_buffer_desc_v1 *desc,
@@ -5,6 +5,7 @@
 
 #include <linux/list.h>
 #include <linux/mm.h>
+#include <linux/bvec.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
 
@@ -53,6 +54,14 @@ void ksmbd_free_work_struct(struct ksmbd_work *work)
 		kfree(ar);
 	}
 
+	if (work->splice_bvec) {
+		int i;
+
+		for (i = 0; i < work->splice_nr_bvec; i++)
+			put_page(work->splice_bvec[i].bv_page);
+		kvfree(work->splice_bvec);
+	}
+
 	kfree(work->tr_buf);
 	kvfree(work->request_buf);
 	kfree(work->iov);
@@ -93,9 +102,18 @@ void ksmbd_workqueue_destroy(void)
 	ksmbd_wq = NULL;
 }
 
+/*
+ * All requests of a connection run on the CPU chosen for it, so the
+ * channels of a multichannel session are spread out instead of piling
+ * up wherever their receiver threads happen to run.
+ */
 bool ksmbd_queue_work(struct ksmbd_work *work)
 {
-	return queue_work(ksmbd_wq, &work->work);
+	int cpu = READ_ONCE(work->conn->work_cpu);
+
+	if (cpu == WORK_CPU_UNBOUND)
+		return queue_work(ksmbd_wq, &work->work);
+	return queue_work_on(cpu, ksmbd_wq, &work->work);
 }
 
 static inline void __ksmbd_iov_pin(struct ksmbd_work *work, void *ib,
@@ -106,35 +124,30 @@ static inline void __ksmbd_iov_pin(struct ksmbd_work *work, void *ib,
 	work->iov_cnt++;
 }
 
-static int __ksmbd_iov_pin_rsp(struct ksmbd_work *work, void *ib, int len,
-			       void *aux_buf, unsigned int aux_size)
+static int ksmbd_iov_reserve(struct ksmbd_work *work, int need_iov_cnt)
 {
-	struct aux_read *ar = NULL;
-	int need_iov_cnt = 1;
+	struct kvec *new;
+	int alloc_cnt;
 
-	if (aux_size) {
+	/* Plus rfc_length size on first iov */
+	if (!work->iov_idx)
 		need_iov_cnt++;
-		ar = kmalloc(sizeof(struct aux_read), GFP_KERNEL);
-		if (!ar)
-			return -ENOMEM;
-	}
 
-	if (work->iov_alloc_cnt < work->iov_cnt + need_iov_cnt) {
-		struct kvec *new;
+	if (work->iov_alloc_cnt >= work->iov_cnt + need_iov_cnt)
+		return 0;
 
-		work->iov_alloc_cnt += 4;
-		new = krealloc(work->iov,
-			       sizeof(struct kvec) * work->iov_alloc_cnt,
-			       GFP_KERNEL | __GFP_ZERO);
-		if (!new) {
-			kfree(ar);
-			work->iov_alloc_cnt -= 4;
-			return -ENOMEM;
-		}
-		work->iov = new;
-	}
+	alloc_cnt = round_up(work->iov_cnt + need_iov_cnt, 4);
+	new = krealloc(work->iov, sizeof(struct kvec) * alloc_cnt,
+		       GFP_KERNEL | __GFP_ZERO);
+	if (!new)
+		return -ENOMEM;
+	work->iov = new;
+	work->iov_alloc_cnt = alloc_cnt;
+	return 0;
+}
 
-	/* Plus rfc_length size on first iov */
+static void ksmbd_iov_pin_hdr(struct ksmbd_work *work, void *ib, int len)
+{
 	if (!work->iov_idx) {
 		work->iov[work->iov_idx].iov_base = work->response_buf;
 		*(__be32 *)work->iov[0].iov_base = 0;
@@ -144,6 +157,27 @@ static int __ksmbd_iov_pin_rsp(struct ksmbd_work *work, void *ib, int len,
 
 	__ksmbd_iov_pin(work, ib, len);
 	inc_rfc1001_len(work->iov[0].iov_base, len);
+}
+
+static int __ksmbd_iov_pin_rsp(struct ksmbd_work *work, void *ib, int len,
+			       void *aux_buf, unsigned int aux_size)
+{
+	struct aux_read *ar = NULL;
+	int need_iov_cnt = 1;
+
+	if (aux_size) {
+		need_iov_cnt++;
+		ar = kmalloc(sizeof(struct aux_read), GFP_KERNEL);
+		if (!ar)
+			return -ENOMEM;
+	}
+
+	if (ksmbd_iov_reserve(work, need_iov_cnt)) {
+		kfree(ar);
+		return -ENOMEM;
+	}
+
+	ksmbd_iov_pin_hdr(work, ib, len);
 
 	if (aux_size) {
 		__ksmbd_iov_pin(work, aux_buf, aux_size);
@@ -167,6 +201,53 @@ int ksmbd_iov_pin_rsp_read(struct ksmbd_work *work, void *ib, int len,
 	return __ksmbd_iov_pin_rsp(work, ib, len, aux_buf, aux_size);
 }
 
+/**
+ * ksmbd_iov_pin_rsp_pages() - pin a response followed by page cache data
+ * @work:	smb work
+ * @ib:		response header
+ * @len:	length of @ib
+ * @bvec:	pages holding the response data, from ksmbd_vfs_splice_read()
+ * @nr_bvec:	number of entries in @bvec
+ *
+ * Each page gets an iov of its own so that signing and encryption can
+ * still walk work->iov, while the transport may send the pages without
+ * copying them. @work takes over @bvec and its page references, also
+ * on error.
+ *
+ * Only one response of a work may reference pages, and the pages must
+ * not be highmem.
+ *
+ * Return:	0 on success, otherwise error
+ */
+int ksmbd_iov_pin_rsp_pages(struct ksmbd_work *work, void *ib, int len,
+			    struct bio_vec *bvec, int nr_bvec)
+{
+	unsigned int size = 0;
+	int i;
+
+	if (WARN_ON_ONCE(work->splice_bvec)) {
+		for (i = 0; i < nr_bvec; i++)
+			put_page(bvec[i].bv_page);
+		kvfree(bvec);
+		return -EINVAL;
+	}
+	work->splice_bvec = bvec;
+	work->splice_nr_bvec = nr_bvec;
+
+	if (ksmbd_iov_reserve(work, 1 + nr_bvec))
+		return -ENOMEM;
+
+	ksmbd_iov_pin_hdr(work, ib, len);
+
+	work->splice_iov_idx = work->iov_idx + 1;
+	for (i = 0; i < nr_bvec; i++) {
+		__ksmbd_iov_pin(work, bvec_virt(&bvec[i]), bvec[i].bv_len);
+		size += bvec[i].bv_len;
+	}
+	inc_rfc1001_len(work->iov[0].iov_base, size);
+	return 0;
+}
+
 int allocate_interim_rsp_buf(struct ksmbd_work *work)
 {
 	work->response_buf = kzalloc(MAX_CIFS_SMALL_BUFFER_SIZE, GFP_KERNEL);
@@ -9,6 +9,7 @@
 #include <linux/ctype.h>
 #include <linux/workqueue.h>
 
+struct bio_vec;
 struct ksmbd_conn;
 struct ksmbd_session;
 struct ksmbd_tree_connect;
@@ -38,6 +39,12 @@ struct ksmbd_work {
 
 	struct list_head		aux_read_list;
 
+	/* Page cache pages sent in place of a READ response buffer */
+	struct bio_vec			*splice_bvec;
+	int				splice_nr_bvec;
+	/* First of the iovs that describe splice_bvec */
+	int				splice_iov_idx;
+
 	struct kvec			*iov;
 	int				iov_alloc_cnt;
 	int				iov_cnt;
@@ -130,6 +137,8 @@ void ksmbd_workqueue_destroy(void);
 bool ksmbd_queue_work(struct ksmbd_work *work);
 int ksmbd_iov_pin_rsp_read(struct ksmbd_work *work, void *ib, int len,
 			   void *aux_buf, unsigned int aux_size);
+int ksmbd_iov_pin_rsp_pages(struct ksmbd_work *work, void *ib, int len,
+			    struct bio_vec *bvec, int nr_bvec);
 int ksmbd_iov_pin_rsp(struct ksmbd_work *work, void *ib, int len);
 int allocate_interim_rsp_buf(struct ksmbd_work *work);
 #endif /* __KSMBD_WORK_H__ */
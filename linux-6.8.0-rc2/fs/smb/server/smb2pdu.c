@@ -13,6 +13,7 @@
 #include <linux/falloc.h>
 #include <linux/mount.h>
 #include <linux/filelock.h>
+#include <linux/bvec.h>
 
 #include "glob.h"
 #include "smbfsctl.h"
@@ -236,6 +237,7 @@ void set_smb2_rsp_status(struct ksmbd_work *work, __le32 err)
 
 	work->iov_idx = 0;
 	work->iov_cnt = 0;
+	work->splice_iov_idx = 0;
 	work->next_smb2_rcv_hdr_off = 0;
 	smb2_set_err_rsp(work);
 }
@@ -6244,6 +6246,70 @@ static ssize_t smb2_read_rdma_channel(struct ksmbd_work *work,
 	return length;
 }
 
+/*
+ * A zero-copy READ response references page cache pages rather than a
+ * copy of the data. Encryption works on the response iovs in place,
+ * signing expects the data of a READ in a single iov, and a page may
+ * change between signing and sending it, so only plain responses to a
+ * single READ request are sent this way.
+ */
+static bool smb2_read_splice_ok(struct ksmbd_work *work,
+				struct smb2_read_req *req)
+{
+	if (IS_ENABLED(CONFIG_HIGHMEM))
+		return false;
+	if (!work->conn->transport->ops->writev_pages)
+		return false;
+	if (work->encrypted || work->next_smb2_rcv_hdr_off ||
+	    req->hdr.NextCommand)
+		return false;
+	if (work->sess->sign ||
+	    work->conn->ops->is_sign_req(work, SMB2_READ_HE))
+		return false;
+	return true;
+}
+
+static void smb2_read_splice_release(struct bio_vec *bvec,
+				     unsigned int nr_bvec)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_bvec; i++)
+		put_page(bvec[i].bv_page);
+	kvfree(bvec);
+}
+
+/*
+ * Returns -EOPNOTSUPP if the data has to be copied by ksmbd_vfs_read()
+ * instead.
+ */
+static ssize_t smb2_read_splice(struct ksmbd_work *work, struct ksmbd_file *fp,
+				size_t length, loff_t *offset,
+				struct bio_vec **bvecp, unsigned int *nr_bvecp)
+{
+	unsigned int nr_bvec = DIV_ROUND_UP(length, PAGE_SIZE) + 1;
+	struct bio_vec *bvec;
+	ssize_t nbytes;
+
+	bvec = kvmalloc_array(nr_bvec, sizeof(*bvec), GFP_KERNEL);
+	if (!bvec)
+		return -EOPNOTSUPP;
+
+	nbytes = ksmbd_vfs_splice_read(work, fp, length, offset, bvec,
+				       &nr_bvec);
+	if (nbytes < 0) {
+		smb2_read_splice_release(bvec, nr_bvec);
+		/* Too fragmented for bvec, copy it */
+		if (nbytes == -ENOSPC)
+			return -EOPNOTSUPP;
+		return nbytes;
+	}
+
+	*bvecp = bvec;
+	*nr_bvecp = nr_bvec;
+	return nbytes;
+}
+
 /**
  * smb2_read() - handler for smb2 read from file
  * @work:	smb work containing read command buffer
@@ -6263,7 +6329,9 @@ int smb2_read(struct ksmbd_work *work)
 	bool is_rdma_channel = false;
 	unsigned int max_read_size = conn->vals->max_read_size;
 	unsigned int id = KSMBD_NO_FID, pid = KSMBD_NO_FID;
-	void *aux_payload_buf;
+	void *aux_payload_buf = NULL;
+	struct bio_vec *bvec = NULL;
+	unsigned int nr_bvec = 0;
 
 	if (test_share_config_flag(work->tcon->share_conf,
 				   KSMBD_SHARE_FLAG_PIPE)) {
@@ -6338,20 +6406,31 @@ int smb2_read(struct ksmbd_work *work)
 	ksmbd_debug(SMB, "filename %pD, offset %lld, len %zu\n",
 		    fp->filp, offset, length);
 
-	aux_payload_buf = kvzalloc(length, GFP_KERNEL);
-	if (!aux_payload_buf) {
-		err = -ENOMEM;
-		goto out;
-	}
+	nbytes = -EOPNOTSUPP;
+	if (!is_rdma_channel && length && smb2_read_splice_ok(work, req))
+		nbytes = smb2_read_splice(work, fp, length, &offset,
+					  &bvec, &nr_bvec);
+
+	if (nbytes == -EOPNOTSUPP) {
+		aux_payload_buf = kvzalloc(length, GFP_KERNEL);
+		if (!aux_payload_buf) {
+			err = -ENOMEM;
+			goto out;
+		}
 
-	nbytes = ksmbd_vfs_read(work, fp, length, &offset, aux_payload_buf);
+		nbytes = ksmbd_vfs_read(work, fp, length, &offset,
+					aux_payload_buf);
+	}
 	if (nbytes < 0) {
+		kvfree(aux_payload_buf);
 		err = nbytes;
 		goto out;
 	}
 
 	if ((nbytes == 0 && length != 0) || nbytes < mincount) {
 		kvfree(aux_payload_buf);
+		if (bvec)
+			smb2_read_splice_release(bvec, nr_bvec);
 		rsp->hdr.Status = STATUS_END_OF_FILE;
 		smb2_set_err_rsp(work);
 		ksmbd_fd_put(work, fp);
@@ -6381,9 +6460,14 @@ int smb2_read(struct ksmbd_work *work)
 	rsp->DataLength = cpu_to_le32(nbytes);
 	rsp->DataRemaining = cpu_to_le32(remain_bytes);
 	rsp->Flags = 0;
-	err = ksmbd_iov_pin_rsp_read(work, (void *)rsp,
-				     offsetof(struct smb2_read_rsp, Buffer),
-				     aux_payload_buf, nbytes);
+	if (bvec)
+		err = ksmbd_iov_pin_rsp_pages(work, (void *)rsp,
+					      offsetof(struct smb2_read_rsp, Buffer),
+					      bvec, nr_bvec);
+	else
+		err = ksmbd_iov_pin_rsp_read(work, (void *)rsp,
+					     offsetof(struct smb2_read_rsp, Buffer),
+					     aux_payload_buf, nbytes);
 	if (err)
 		goto out;
 	ksmbd_fd_put(work, fp);
@@ -71,6 +71,20 @@ static inline void ksmbd_tcp_snd_timeout(struct socket *sock, s64 secs)
 	sock_set_sndtimeo(sock->sk, secs);
 }
 
+/*
+ * Run the requests of a connection on the CPU that receives its
+ * packets, where the request data is still cache hot. With RSS the
+ * channels of a multichannel session then land on different CPUs.
+ */
+static int ksmbd_tcp_work_cpu(struct socket *sock)
+{
+	int cpu = READ_ONCE(sock->sk->sk_incoming_cpu);
+
+	if (cpu < 0 || cpu >= nr_cpu_ids || !cpu_online(cpu))
+		return WORK_CPU_UNBOUND;
+	return cpu;
+}
+
 static struct tcp_transport *alloc_transport(struct socket *client_sk)
 {
 	struct tcp_transport *t;
@@ -90,6 +104,7 @@ static struct tcp_transport *alloc_transport(struct socket *client_sk)
 	conn->transport = KSMBD_TRANS(t);
 	KSMBD_TRANS(t)->conn = conn;
 	KSMBD_TRANS(t)->ops = &ksmbd_tcp_transport_ops;
+	conn->work_cpu = ksmbd_tcp_work_cpu(client_sk);
 	return t;
 }
 
@@ -391,6 +406,69 @@ static int ksmbd_tcp_writev(struct ksmbd_transport *t, struct kvec *iov,
 	return kernel_sendmsg(TCP_TRANS(t)->sock, &smb_msg, iov, nvecs, size);
 }
 
+static int ksmbd_tcp_sendmsg(struct socket *sock, struct msghdr *msg,
+			     size_t len)
+{
+	int sent = sock_sendmsg(sock, msg);
+
+	if (sent >= 0 && sent != len)
+		return -EIO;
+	return sent;
+}
+
+static int ksmbd_tcp_send_kvec(struct socket *sock, struct kvec *iov,
+			       int nvecs, bool more)
+{
+	struct msghdr msg = {.msg_flags = MSG_NOSIGNAL};
+	size_t len = 0;
+	int i;
+
+	if (!nvecs)
+		return 0;
+	for (i = 0; i < nvecs; i++)
+		len += iov[i].iov_len;
+	if (more)
+		msg.msg_flags |= MSG_MORE;
+	iov_iter_kvec(&msg.msg_iter, ITER_SOURCE, iov, nvecs, len);
+	return ksmbd_tcp_sendmsg(sock, &msg, len);
+}
+
+/*
+ * Send the iovs before page_idx, then the page cache pages behind
+ * iov[page_idx..page_idx + nr_bvec - 1] by reference, then the rest.
+ */
+static int ksmbd_tcp_writev_pages(struct ksmbd_transport *t, struct kvec *iov,
+				  int nvecs, int size, int page_idx,
+				  struct bio_vec *bvec, int nr_bvec)
+{
+	struct socket *sock = TCP_TRANS(t)->sock;
+	struct msghdr msg = {
+		.msg_flags = MSG_NOSIGNAL | MSG_SPLICE_PAGES,
+	};
+	int tail_idx = page_idx + nr_bvec;
+	size_t len = 0;
+	int i, ret;
+
+	ret = ksmbd_tcp_send_kvec(sock, iov, page_idx, true);
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < nr_bvec; i++)
+		len += bvec[i].bv_len;
+	if (tail_idx < nvecs)
+		msg.msg_flags |= MSG_MORE;
+	iov_iter_bvec(&msg.msg_iter, ITER_SOURCE, bvec, nr_bvec, len);
+	ret = ksmbd_tcp_sendmsg(sock, &msg, len);
+	if (ret < 0)
+		return ret;
+
+	ret = ksmbd_tcp_send_kvec(sock, iov + tail_idx, nvecs - tail_idx,
+				  false);
+	if (ret < 0)
+		return ret;
+	return size;
+}
+
 static void ksmbd_tcp_disconnect(struct ksmbd_transport *t)
 {
 	free_transport(TCP_TRANS(t));
@@ -648,5 +726,6 @@ int ksmbd_tcp_set_interfaces(char *ifc_list, int ifc_list_sz)
 static struct ksmbd_transport_ops ksmbd_tcp_transport_ops = {
 	.read		= ksmbd_tcp_read,
 	.writev		= ksmbd_tcp_writev,
+	.writev_pages	= ksmbd_tcp_writev_pages,
 	.disconnect	= ksmbd_tcp_disconnect,
 };
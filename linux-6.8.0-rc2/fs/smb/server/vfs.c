@@ -19,6 +19,8 @@
 #include <linux/sched/xacct.h>
 #include <linux/crc32c.h>
 #include <linux/namei.h>
+#include <linux/splice.h>
+#include <linux/bvec.h>
 
 #include "glob.h"
 #include "oplock.h"
@@ -361,6 +363,34 @@ out:
 	return error;
 }
 
+static int ksmbd_vfs_read_access(struct ksmbd_work *work,
+				 struct ksmbd_file *fp)
+{
+	if (work->conn->connection_type) {
+		if (!(fp->daccess & (FILE_READ_DATA_LE | FILE_EXECUTE_LE))) {
+			pr_err("no right to read(%pD)\n", fp->filp);
+			return -EACCES;
+		}
+	}
+	return 0;
+}
+
+static int ksmbd_vfs_read_lock_check(struct ksmbd_work *work,
+				     struct file *filp, loff_t pos,
+				     size_t count)
+{
+	if (!work->tcon->posix_extensions) {
+		int ret;
+
+		ret = check_lock_range(filp, pos, pos + count - 1, READ);
+		if (ret) {
+			pr_err("unable to read due to lock\n");
+			return -EAGAIN;
+		}
+	}
+	return 0;
+}
+
 /**
  * ksmbd_vfs_read() - vfs helper for smb file read
  * @work:	smb work
@@ -384,25 +414,16 @@ int ksmbd_vfs_read(struct ksmbd_work *work, struct ksmbd_file *fp, size_t count,
 	if (unlikely(count == 0))
 		return 0;
 
-	if (work->conn->connection_type) {
-		if (!(fp->daccess & (FILE_READ_DATA_LE | FILE_EXECUTE_LE))) {
-			pr_err("no right to read(%pD)\n", fp->filp);
-			return -EACCES;
-		}
-	}
+	nbytes = ksmbd_vfs_read_access(work, fp);
+	if (nbytes)
+		return nbytes;
 
 	if (ksmbd_stream_fd(fp))
 		return ksmbd_vfs_stream_read(fp, rbuf, pos, count);
 
-	if (!work->tcon->posix_extensions) {
-		int ret;
-
-		ret = check_lock_range(filp, *pos, *pos + count - 1, READ);
-		if (ret) {
-			pr_err("unable to read due to lock\n");
-			return -EAGAIN;
-		}
-	}
+	nbytes = ksmbd_vfs_read_lock_check(work, filp, *pos, count);
+	if (nbytes)
+		return nbytes;
 
 	nbytes = kernel_read(filp, rbuf, count, pos);
 	if (nbytes < 0) {
@@ -414,6 +435,109 @@ int ksmbd_vfs_read(struct ksmbd_work *work, struct ksmbd_file *fp, size_t count,
 	return nbytes;
 }
 
+struct ksmbd_splice_data {
+	struct bio_vec		*bvec;
+	unsigned int		nr_bvec;
+	unsigned int		max_bvec;
+};
+
+static int ksmbd_vfs_splice_actor(struct pipe_inode_info *pipe,
+				  struct pipe_buffer *buf,
+				  struct splice_desc *sd)
+{
+	struct ksmbd_splice_data *data = sd->u.data;
+	struct page *page = buf->page + buf->offset / PAGE_SIZE; /* may be compound */
+	unsigned int offset = offset_in_page(buf->offset);
+	unsigned int remaining = sd->len;
+
+	while (remaining) {
+		unsigned int len = min_t(unsigned int, remaining,
+					 PAGE_SIZE - offset);
+
+		if (data->nr_bvec == data->max_bvec)
+			return -ENOSPC;
+		get_page(page);
+		bvec_set_page(&data->bvec[data->nr_bvec++], page, len, offset);
+		remaining -= len;
+		offset = 0;
+		page++;
+	}
+	return sd->len;
+}
+
+static int ksmbd_vfs_direct_splice_actor(struct pipe_inode_info *pipe,
+					 struct splice_desc *sd)
+{
+	return __splice_from_pipe(pipe, sd, ksmbd_vfs_splice_actor);
+}
+
+/**
+ * ksmbd_vfs_splice_read() - read file data by referencing page cache pages
+ * @work:	smb work
+ * @fp:		ksmbd file pointer
+ * @count:	read byte count
+ * @pos:	file pos
+ * @bvec:	array receiving a reference to each page read
+ * @nr_bvec:	IN: size of @bvec; OUT: number of entries filled
+ *
+ * Unlike ksmbd_vfs_read(), no data is copied. The caller owns a page
+ * reference for each entry of @bvec filled in, also on error.
+ * -EOPNOTSUPP means the file cannot be spliced and ksmbd_vfs_read()
+ * has to be used instead.
+ *
+ * Return:	number of read bytes on success, otherwise error
+ */
+int ksmbd_vfs_splice_read(struct ksmbd_work *work, struct ksmbd_file *fp,
+			  size_t count, loff_t *pos, struct bio_vec *bvec,
+			  unsigned int *nr_bvec)
+{
+	struct file *filp = fp->filp;
+	struct ksmbd_splice_data data = {
+		.bvec		= bvec,
+		.max_bvec	= *nr_bvec,
+	};
+	struct splice_desc sd = {
+		.len		= 0,
+		.total_len	= count,
+		.pos		= *pos,
+		.u.data		= &data,
+	};
+	ssize_t nbytes;
+
+	*nr_bvec = 0;
+	if (S_ISDIR(file_inode(filp)->i_mode))
+		return -EISDIR;
+
+	if (ksmbd_stream_fd(fp) || !filp->f_op->splice_read)
+		return -EOPNOTSUPP;
+
+	if (unlikely(count == 0))
+		return 0;
+
+	nbytes = ksmbd_vfs_read_access(work, fp);
+	if (nbytes)
+		return nbytes;
+
+	nbytes = ksmbd_vfs_read_lock_check(work, filp, *pos, count);
+	if (nbytes)
+		return nbytes;
+
+	nbytes = rw_verify_area(READ, filp, pos, count);
+	if (!nbytes)
+		nbytes = splice_direct_to_actor(filp, &sd,
+						ksmbd_vfs_direct_splice_actor);
+	*nr_bvec = data.nr_bvec;
+	if (nbytes < 0) {
+		if (nbytes != -ENOSPC)
+			pr_err("smb splice read failed, err = %zd\n", nbytes);
+		return nbytes;
+	}
+
+	*pos += nbytes;
+	filp->f_pos = *pos;
+	return nbytes;
+}
+
 static int ksmbd_vfs_stream_write(struct ksmbd_file *fp, char *buf, loff_t *pos,
 				  size_t count)
 {
@@ -35,6 +35,7 @@ enum {
 
 struct ksmbd_work;
 struct ksmbd_file;
+struct bio_vec;
 struct ksmbd_conn;
 
 struct ksmbd_dir_info {
@@ -78,6 +79,9 @@ int ksmbd_vfs_create(struct ksmbd_work *work, const char *name, umode_t mode);
 int ksmbd_vfs_mkdir(struct ksmbd_work *work, const char *name, umode_t mode);
 int ksmbd_vfs_read(struct ksmbd_work *work, struct ksmbd_file *fp, size_t count,
 		   loff_t *pos, char *rbuf);
+int ksmbd_vfs_splice_read(struct ksmbd_work *work, struct ksmbd_file *fp,
+			  size_t count, loff_t *pos, struct bio_vec *bvec,
+			  unsigned int *nr_bvec);
 int ksmbd_vfs_write(struct ksmbd_work *work, struct ksmbd_file *fp,
 		    char *buf, size_t count, loff_t *pos, bool sync,
 		    ssize_t *written);
@@ -40,6 +40,7 @@ struct fscache_cache {
 	atomic_t		n_volumes;	/* Number of active volumes; */
 	atomic_t		n_accesses;	/* Number of in-progress accesses on the cache */
 	atomic_t		object_count;	/* no. of live objects in this cache */
+	atomic_t		n_writes_in_flight; /* netfs copies to the cache in progress */
 	unsigned int		debug_id;
 	enum fscache_cache_state state;
 	char			*name;
@@ -6,6 +6,9 @@
 #include <linux/xarray.h>
 #include <uapi/linux/io_uring.h>
 
+struct io_uring_cmd;
+struct request;
+
 #if defined(CONFIG_IO_URING)
 void __io_uring_cancel(bool cancel_all);
 void __io_uring_free(struct task_struct *tsk);
@@ -13,6 +16,11 @@ void io_uring_unreg_ringfd(void);
 const char *io_uring_get_opcode(u8 opcode);
 int io_uring_cmd_sock(struct io_uring_cmd *cmd, unsigned int issue_flags);
 bool io_is_uring_fops(struct file *file);
+int io_buffer_register_bvec(struct io_uring_cmd *ioucmd, struct request *rq,
+			    void (*release)(void *), unsigned int index,
+			    unsigned int issue_flags);
+int io_buffer_unregister_bvec(struct io_uring_cmd *ioucmd, struct request *rq,
+			      unsigned int index, unsigned int issue_flags);
 
 static inline void io_uring_files_cancel(void)
 {
@@ -54,6 +62,21 @@ static inline bool io_is_uring_fops(struct file *file)
 {
 	return false;
 }
+static inline int io_buffer_register_bvec(struct io_uring_cmd *ioucmd,
+					  struct request *rq,
+					  void (*release)(void *),
+					  unsigned int index,
+					  unsigned int issue_flags)
+{
+	return -EOPNOTSUPP;
+}
+static inline int io_buffer_unregister_bvec(struct io_uring_cmd *ioucmd,
+					    struct request *rq,
+					    unsigned int index,
+					    unsigned int issue_flags)
+{
+	return -EOPNOTSUPP;
+}
 #endif
 
 #endif
@@ -264,6 +264,9 @@ struct xt_table_info {
 	unsigned int stacksize;
 	void ***jumpstack;
 
+	/* Optional destination address classifier, see x_tables_classify.c */
+	struct xt_classifier *classifier;
+
 	unsigned char entries[] __aligned(8);
 };
 
@@ -335,6 +338,18 @@ void xt_proto_fini(struct net *net, u_int8_t af);
 struct xt_table_info *xt_alloc_table_info(unsigned int size);
 void xt_free_table_info(struct xt_table_info *info);
 
+struct xt_classifier;
+
+struct xt_classifier *xt_classifier_alloc(u_int8_t af, unsigned int number);
+void xt_classifier_add(struct xt_classifier *c, unsigned int offset,
+		       const union nf_inet_addr *dst,
+		       const union nf_inet_addr *dmsk, bool wildcard);
+int xt_classifier_build(struct xt_classifier *c);
+unsigned int xt_classifier_next(const struct xt_classifier *c,
+				unsigned int offset,
+				const union nf_inet_addr *daddr);
+void xt_classifier_free(struct xt_classifier *c);
+
 /**
  * xt_recseq - recursive seqcount for netfilter use
  *
@@ -19,6 +19,8 @@
 #include <linux/sunrpc/svcauth.h>
 #include <linux/lwq.h>
 #include <linux/wait.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
 #include <linux/mm.h>
 #include <linux/pagevec.h>
 
@@ -38,12 +40,19 @@ struct svc_pool {
 	atomic_t		sp_nrthreads;	/* # of threads in pool */
 	struct list_head	sp_all_threads;	/* all server threads */
 	struct llist_head	sp_idle_threads; /* idle server threads */
+	spinlock_t		sp_idle_lock;	/* serialises removal from
+						 * sp_idle_threads */
 
 	/* statistics on pool operation */
 	struct percpu_counter	sp_messages_arrived;
 	struct percpu_counter	sp_sockets_queued;
 	struct percpu_counter	sp_threads_woken;
+	struct percpu_counter	sp_threads_timedout;
+	struct percpu_counter	sp_threads_spawned;
+	struct percpu_counter	sp_threads_retired;
 
+	unsigned int		sp_nrthrmin;	/* idle threads are not retired
+						 * below this count */
 	unsigned long		sp_flags;
 } ____cacheline_aligned_in_smp;
 
@@ -52,6 +61,7 @@ enum {
 	SP_TASK_PENDING,	/* still work to do even if no xprt is queued */
 	SP_NEED_VICTIM,		/* One thread needs to agree to exit */
 	SP_VICTIM_REMAINS,	/* One thread needs to actually exit */
+	SP_NEED_THREAD,		/* sv_spawn_work should start a thread */
 };
 
 
@@ -70,6 +80,12 @@ struct svc_serv {
 	struct svc_stat *	sv_stats;	/* RPC statistics */
 	spinlock_t		sv_lock;
 	unsigned int		sv_nrthreads;	/* # of server threads */
+	unsigned int		sv_nrthrmax;	/* max threads started on demand
+						 * or '0' to keep the number of
+						 * threads fixed. */
+	struct mutex		sv_thread_mutex; /* serialises changes to the
+						  * number of threads */
+	struct work_struct	sv_spawn_work;	/* starts threads on demand */
 	unsigned int		sv_maxconn;	/* max connections allowed or
 						 * '0' causing max to be based
 						 * on number of threads. */
@@ -423,6 +439,9 @@ int		   svc_register(const struct svc_serv *, struct net *, const int,
 void		   svc_wake_up(struct svc_serv *);
 void		   svc_reserve(struct svc_rqst *rqstp, int space);
 void		   svc_pool_wake_idle_thread(struct svc_pool *pool);
+void		   svc_pool_try_spawn_thread(struct svc_serv *serv,
+					     struct svc_pool *pool);
+bool		   svc_pool_try_retire_thread(struct svc_rqst *rqstp);
 struct svc_pool   *svc_pool_for_cpu(struct svc_serv *serv);
 char *		   svc_print_addr(struct svc_rqst *, char *, size_t);
 const char *	   svc_proc_name(const struct svc_rqst *rqstp);
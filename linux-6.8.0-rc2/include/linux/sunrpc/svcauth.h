@@ -153,6 +153,10 @@ struct svc_xprt;
 
 extern enum svc_auth_status svc_authenticate(struct svc_rqst *rqstp);
 extern rpc_authflavor_t svc_auth_flavor(struct svc_rqst *rqstp);
+struct rpc_clnt;
+extern void svcauth_map_clnt_to_svc_cred_local(struct rpc_clnt *clnt,
+					       const struct cred *,
+					       struct svc_cred *);
 extern int	svc_authorise(struct svc_rqst *rqstp);
 extern enum svc_auth_status svc_set_client(struct svc_rqst *rqstp);
 extern int	svc_auth_register(rpc_authflavor_t flavor, struct auth_ops *aops);
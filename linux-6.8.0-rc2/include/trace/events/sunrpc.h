@@ -2142,6 +2142,40 @@ TRACE_EVENT(svc_wake_up,
 	TP_printk("pid=%d", __entry->pid)
 );
 
+DECLARE_EVENT_CLASS(svc_pool_thread_class,
+	TP_PROTO(
+		const struct svc_pool *pool,
+		unsigned int nrthreads
+	),
+
+	TP_ARGS(pool, nrthreads),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, pool_id)
+		__field(unsigned int, nrthreads)
+	),
+
+	TP_fast_assign(
+		__entry->pool_id = pool->sp_id;
+		__entry->nrthreads = nrthreads;
+	),
+
+	TP_printk("pool=%u nrthreads=%u",
+		__entry->pool_id, __entry->nrthreads
+	)
+);
+
+#define DEFINE_SVC_POOL_THREAD_EVENT(name) \
+	DEFINE_EVENT(svc_pool_thread_class, svc_pool_thread_##name, \
+			TP_PROTO( \
+				const struct svc_pool *pool, \
+				unsigned int nrthreads \
+			), \
+			TP_ARGS(pool, nrthreads))
+
+DEFINE_SVC_POOL_THREAD_EVENT(spawned);
+DEFINE_SVC_POOL_THREAD_EVENT(retired);
+
 TRACE_EVENT(svc_alloc_arg_err,
 	TP_PROTO(
 		unsigned int requested,
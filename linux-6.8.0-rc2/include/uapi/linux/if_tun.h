@@ -61,6 +61,7 @@
 #define TUNSETFILTEREBPF _IOR('T', 225, int)
 #define TUNSETCARRIER _IOW('T', 226, int)
 #define TUNGETDEVNETNS _IO('T', 227)
+#define TUNSETRING _IOWR('T', 228, struct tun_ring_req)
 
 /* TUNSETIFF ifr flags */
 #define IFF_TUN		0x0001
@@ -100,6 +101,43 @@ struct tun_pi {
 	__be16 proto;
 };
 
+/*
+ * Shared-memory packet rings (TUNSETRING)
+ *
+ * Once set up on a queue fd, packets are exchanged through two rings of
+ * descriptors and a packet buffer area, all mapped by mmap() at offset 0.
+ * Descriptor n of a ring always refers to frame n of the same ring; each
+ * frame holds one packet in the same format read() and write() would use.
+ * Producer and consumer are free running indices.
+ *
+ * The rx ring is produced by the kernel: read() moves pending packets into
+ * it. The tx ring is produced by user space: write() sends the packets
+ * queued in it. In this mode read() and write() ignore their buffers and
+ * return the number of packets moved. poll() only reports readiness, it
+ * does not move packets.
+ */
+struct tun_ring_offsets {
+	__u64 producer;
+	__u64 consumer;
+	__u64 desc;
+	__u64 frames;
+};
+
+struct tun_ring_req {
+	__u32 nr_descs;		/* Descriptors per ring, power of two */
+	__u32 frame_size;	/* Bytes per frame */
+	/* Filled in by the kernel */
+	__u64 mmap_size;
+	struct tun_ring_offsets rx;
+	struct tun_ring_offsets tx;
+};
+
+#define TUN_RING_DESC_TRUNC 0x0001	/* Packet did not fit into the frame */
+struct tun_ring_desc {
+	__u32 len;
+	__u32 flags;
+};
+
 /*
  * Filter spec (used for SETXXFILTER ioctls)
  * This stuff is applicable only to the TAP (Ethernet) devices.
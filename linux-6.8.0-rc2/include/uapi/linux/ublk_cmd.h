@@ -75,6 +75,17 @@
  *
  *      It is only used if ublksrv set UBLK_F_NEED_GET_DATA flag
  *      while starting a ublk device.
+ *
+ * REGISTER_IO_BUF: only used with UBLK_F_SUPPORT_ZERO_COPY, registers the
+ *      pages of the request `tag` as fixed buffer `addr` of the io_uring
+ *      the command is issued on. The buffer table has to be registered
+ *      beforehand, e.g. as a sparse one. The request can then be served
+ *      with READ_FIXED, WRITE_FIXED, SEND_ZC, ... against buffer
+ *      address 0, without copying its data.
+ *
+ * UNREGISTER_IO_BUF: unregisters the buffer again. A buffer still
+ *      registered is unregistered by COMMIT_AND_FETCH_REQ, the request is
+ *      completed once no io_uring request uses its pages any more.
  */
 
 /*
@@ -84,6 +95,8 @@
 #define	UBLK_IO_FETCH_REQ		0x20
 #define	UBLK_IO_COMMIT_AND_FETCH_REQ	0x21
 #define	UBLK_IO_NEED_GET_DATA	0x22
+#define	UBLK_IO_REGISTER_IO_BUF		0x23
+#define	UBLK_IO_UNREGISTER_IO_BUF	0x24
 
 /* Any new IO command should encode by __IOWR() */
 #define	UBLK_U_IO_FETCH_REQ		\
@@ -92,6 +105,10 @@
 	_IOWR('u', UBLK_IO_COMMIT_AND_FETCH_REQ, struct ublksrv_io_cmd)
 #define	UBLK_U_IO_NEED_GET_DATA		\
 	_IOWR('u', UBLK_IO_NEED_GET_DATA, struct ublksrv_io_cmd)
+#define	UBLK_U_IO_REGISTER_IO_BUF	\
+	_IOWR('u', UBLK_IO_REGISTER_IO_BUF, struct ublksrv_io_cmd)
+#define	UBLK_U_IO_UNREGISTER_IO_BUF	\
+	_IOWR('u', UBLK_IO_UNREGISTER_IO_BUF, struct ublksrv_io_cmd)
 
 /* only ABORT means that no re-fetch */
 #define UBLK_IO_RES_OK			0
@@ -125,8 +142,9 @@
 #define UBLKSRV_IO_BUF_TOTAL_SIZE	(1ULL << UBLKSRV_IO_BUF_TOTAL_BITS)
 
 /*
- * zero copy requires 4k block size, and can remap ublk driver's io
- * request into ublksrv's vm space
+ * zero copy: the pages of an io request are registered as io_uring fixed
+ * buffer with UBLK_U_IO_REGISTER_IO_BUF, ublksrv does io against them
+ * instead of copying the data. Not supported for unprivileged devices.
  */
 #define UBLK_F_SUPPORT_ZERO_COPY	(1ULL << 0)
 
@@ -13,4 +13,11 @@ struct sockaddr_un {
 
 #define SIOCUNIXFILE (SIOCPROTOPRIVATE + 0) /* open a socket file with O_PATH */
 
+/* MSG_ZEROCOPY notifications of SOCK_STREAM sockets are read from the error
+ * queue as a sock_extended_err with this cmsg level and type.  See
+ * Documentation/networking/msg_zerocopy.rst for the format.
+ */
+#define SOL_UNIX	288
+#define UNIX_RECVERR	1
+
 #endif /* _LINUX_UN_H */
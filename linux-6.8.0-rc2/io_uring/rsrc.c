@@ -9,6 +9,7 @@
 #include <linux/hugetlb.h>
 #include <linux/compat.h>
 #include <linux/io_uring.h>
+#include <linux/blk-mq.h>
 
 #include <uapi/linux/io_uring.h>
 
@@ -138,10 +139,14 @@ static void io_buffer_unmap(struct io_ring_ctx *ctx, struct io_mapped_ubuf **slo
 	unsigned int i;
 
 	if (imu != &dummy_ubuf) {
-		for (i = 0; i < imu->nr_bvecs; i++)
-			unpin_user_page(imu->bvec[i].bv_page);
-		if (imu->acct_pages)
-			io_unaccount_mem(ctx, imu->acct_pages);
+		if (imu->release) {
+			imu->release(imu->priv);
+		} else {
+			for (i = 0; i < imu->nr_bvecs; i++)
+				unpin_user_page(imu->bvec[i].bv_page);
+			if (imu->acct_pages)
+				io_unaccount_mem(ctx, imu->acct_pages);
+		}
 		kvfree(imu);
 	}
 	*slot = NULL;
@@ -449,11 +454,16 @@ static int __io_sqe_buffers_update(struct io_ring_ctx *ctx,
 			err = -EINVAL;
 			break;
 		}
+		i = array_index_nospec(up->offset + done, ctx->nr_user_bufs);
+		/* kernel buffers are owned by their driver until it drops them */
+		if (ctx->user_bufs[i]->release) {
+			err = -EBUSY;
+			break;
+		}
 		err = io_sqe_buffer_register(ctx, &iov, &imu, &last_hpage);
 		if (err)
 			break;
 
-		i = array_index_nospec(up->offset + done, ctx->nr_user_bufs);
 		if (ctx->user_bufs[i] != &dummy_ubuf) {
 			err = io_queue_rsrc_removal(ctx->buf_data, i,
 						    ctx->user_bufs[i]);
@@ -829,6 +839,9 @@ static bool headpage_already_acct(struct io_ring_ctx *ctx, struct page **pages,
 	for (i = 0; i < ctx->nr_user_bufs; i++) {
 		struct io_mapped_ubuf *imu = ctx->user_bufs[i];
 
+		/* kernel buffers are not pinned nor accounted */
+		if (imu->release)
+			continue;
 		for (j = 0; j < imu->nr_bvecs; j++) {
 			if (!PageCompound(imu->bvec[j].bv_page))
 				continue;
@@ -974,6 +987,7 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	imu->ubuf = (unsigned long) iov->iov_base;
 	imu->ubuf_end = imu->ubuf + iov->iov_len;
 	imu->nr_bvecs = nr_pages;
+	imu->release = NULL;
 	*pimu = imu;
 	ret = 0;
 
@@ -1070,6 +1084,9 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 	/* not inside the mapped region */
 	if (unlikely(buf_addr < imu->ubuf || buf_end > imu->ubuf_end))
 		return -EFAULT;
+	/* kernel buffers may only be used in the direction of the I/O */
+	if (unlikely(imu->release && ddir != imu->dir))
+		return -EFAULT;
 
 	/*
 	 * Might not be a start of buffer, set size appropriately
@@ -1078,7 +1095,10 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 	offset = buf_addr - imu->ubuf;
 	iov_iter_bvec(iter, ddir, imu->bvec, imu->nr_bvecs, offset + len);
 
-	if (offset) {
+	/* the segments of a kernel buffer can have any size */
+	if (offset && imu->release) {
+		iov_iter_advance(iter, offset);
+	} else if (offset) {
 		/*
 		 * Don't use iov_iter_advance() here, as it's really slow for
 		 * using the latter parts of a big fixed buffer - it iterates
@@ -1123,3 +1143,118 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 
 	return 0;
 }
+
+/**
+ * io_buffer_register_bvec - register the data of a block request as a
+ *			     fixed buffer
+ * @ioucmd:	uring_cmd issued on the ring the buffer is registered in
+ * @rq:		request whose bvecs make up the buffer
+ * @release:	called with @rq once the buffer is unregistered and no
+ *		request of the ring uses it any more
+ * @index:	slot in the ring's buffer table, which must be empty
+ * @issue_flags: issue flags of @ioucmd
+ *
+ * This lets the server side of a block driver, e.g. ublk, issue
+ * READ_FIXED, WRITE_FIXED or SEND_ZC directly against the pages of a
+ * request. The buffer starts at address 0 and can only be used in the
+ * direction of the data transfer of @rq: written to for a read request,
+ * read from for a write request. The buffer table must have been
+ * registered beforehand, e.g. as a sparse one.
+ */
+int io_buffer_register_bvec(struct io_uring_cmd *ioucmd, struct request *rq,
+			    void (*release)(void *), unsigned int index,
+			    unsigned int issue_flags)
+{
+	struct io_ring_ctx *ctx = cmd_to_io_kiocb(ioucmd)->ctx;
+	struct io_mapped_ubuf *imu;
+	struct req_iterator rq_iter;
+	unsigned int nr_bvecs = 0;
+	struct bio_vec bv;
+	int ret = 0;
+
+	io_ring_submit_lock(ctx, issue_flags);
+	if (!ctx->buf_data) {
+		ret = -ENXIO;
+		goto unlock;
+	}
+	if (index >= ctx->nr_user_bufs) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+	index = array_index_nospec(index, ctx->nr_user_bufs);
+	if (ctx->user_bufs[index] != &dummy_ubuf) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	rq_for_each_bvec(bv, rq, rq_iter)
+		nr_bvecs++;
+
+	imu = kvmalloc(struct_size(imu, bvec, nr_bvecs), GFP_KERNEL);
+	if (!imu) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	imu->nr_bvecs = nr_bvecs;
+	nr_bvecs = 0;
+	rq_for_each_bvec(bv, rq, rq_iter)
+		imu->bvec[nr_bvecs++] = bv;
+
+	imu->ubuf = 0;
+	imu->ubuf_end = blk_rq_bytes(rq);
+	imu->acct_pages = 0;
+	imu->release = release;
+	imu->priv = rq;
+	imu->dir = op_is_write(req_op(rq)) ? ITER_SOURCE : ITER_DEST;
+
+	ctx->user_bufs[index] = imu;
+	*io_get_tag_slot(ctx->buf_data, index) = 0;
+unlock:
+	io_ring_submit_unlock(ctx, issue_flags);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(io_buffer_register_bvec);
+
+/**
+ * io_buffer_unregister_bvec - unregister a buffer of io_buffer_register_bvec()
+ * @ioucmd:	uring_cmd issued on the ring the buffer is registered in
+ * @rq:		request the buffer was registered for
+ * @index:	slot in the ring's buffer table
+ * @issue_flags: issue flags of @ioucmd
+ *
+ * The slot is free again on return, the release callback runs once the
+ * requests still using the buffer have completed. Fails with -EINVAL if
+ * the slot does not hold the buffer of @rq.
+ */
+int io_buffer_unregister_bvec(struct io_uring_cmd *ioucmd, struct request *rq,
+			      unsigned int index, unsigned int issue_flags)
+{
+	struct io_ring_ctx *ctx = cmd_to_io_kiocb(ioucmd)->ctx;
+	struct io_mapped_ubuf *imu;
+	int ret;
+
+	io_ring_submit_lock(ctx, issue_flags);
+	if (!ctx->buf_data) {
+		ret = -ENXIO;
+		goto unlock;
+	}
+	if (index >= ctx->nr_user_bufs) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+	index = array_index_nospec(index, ctx->nr_user_bufs);
+	imu = ctx->user_bufs[index];
+	if (!imu->release || imu->priv != rq) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	ret = io_queue_rsrc_removal(ctx->buf_data, index, imu);
+	if (!ret)
+		ctx->user_bufs[index] = (struct io_mapped_ubuf *)&dummy_ubuf;
+unlock:
+	io_ring_submit_unlock(ctx, issue_flags);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(io_buffer_unregister_bvec);
@@ -54,6 +54,10 @@ struct io_mapped_ubuf {
 	u64		ubuf_end;
 	unsigned int	nr_bvecs;
 	unsigned long	acct_pages;
+	/* kernel buffers, see io_buffer_register_bvec() */
+	void		(*release)(void *);
+	void		*priv;
+	int		dir;
 	struct bio_vec	bvec[] __counted_by(nr_bvecs);
 };
 
@@ -15,9 +15,11 @@
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
 #include <linux/jhash.h>
+#include <linux/hash.h>
 #include <linux/random.h>
 #include <linux/slab.h>
 #include <linux/atomic.h>
+#include <linux/seqlock.h>
 #include <asm/unaligned.h>
 #include <linux/if_vlan.h>
 #include <net/switchdev.h>
@@ -58,6 +60,7 @@ int br_fdb_hash_init(struct net_bridge *br)
 void br_fdb_hash_fini(struct net_bridge *br)
 {
 	rhashtable_destroy(&br->fdb_hash_tbl);
+	free_percpu(br->fdb_lazy);
 }
 
 /* if topology_changing then use forward_delay (default 15 sec)
@@ -226,6 +229,148 @@ static struct net_bridge_fdb_entry *fdb_find_rcu(struct rhashtable *tbl,
 	return rhashtable_lookup(tbl, &key, br_fdb_rht_params);
 }
 
+/* Lazy refresh: instead of writing fdb->updated and fdb->used from every
+ * RX cpu, which makes the entry's cache line bounce between them, the
+ * packet path records the time in a small per-cpu table indexed by the
+ * fdb key.  The gc work folds those into the entries before ageing them.
+ * A slot may be taken over by another entry before it is folded, so the
+ * entry itself is still written once its timestamp is older than
+ * BR_FDB_LAZY_MAX_AGE, which bounds the ageing error.
+ */
+#define BR_FDB_LAZY_BITS	8
+#define BR_FDB_LAZY_SLOTS	(1 << BR_FDB_LAZY_BITS)
+#define BR_FDB_LAZY_MAX_AGE	HZ
+
+struct br_fdb_lazy_slot {
+	seqcount_t		seq;	/* written by the owning cpu only */
+	u64			key;	/* struct net_bridge_fdb_key */
+	unsigned long		updated;
+	unsigned long		used;
+};
+
+static u64 fdb_lazy_key(const struct net_bridge_fdb_key *key)
+{
+	u64 k;
+
+	BUILD_BUG_ON(sizeof(*key) != sizeof(k));
+	memcpy(&k, key, sizeof(k));
+	return k;
+}
+
+/* Called from the packet path, returns false if the caller has to write
+ * the timestamp to the entry itself.
+ */
+bool br_fdb_refresh_deferred(struct net_bridge *br,
+			     struct net_bridge_fdb_entry *fdb,
+			     unsigned long now, bool used)
+{
+	struct br_fdb_lazy_slot __percpu *slots;
+	struct br_fdb_lazy_slot *slot;
+	unsigned long stamp;
+	u64 key;
+
+	if (!br_opt_get(br, BROPT_FDB_LAZY_REFRESH))
+		return false;
+
+	stamp = used ? READ_ONCE(fdb->used) : READ_ONCE(fdb->updated);
+	if (time_after(now, stamp + BR_FDB_LAZY_MAX_AGE))
+		return false;
+
+	slots = READ_ONCE(br->fdb_lazy);
+	if (!slots)
+		return false;
+
+	key = fdb_lazy_key(&fdb->key);
+	slot = this_cpu_ptr(slots) + hash_64(key, BR_FDB_LAZY_BITS);
+
+	/* BHs are disabled on both the rx and the tx path */
+	write_seqcount_begin(&slot->seq);
+	if (slot->key != key) {
+		slot->key = key;
+		slot->updated = 0;
+		slot->used = 0;
+	}
+	if (used)
+		slot->used = now;
+	else
+		slot->updated = now;
+	write_seqcount_end(&slot->seq);
+
+	return true;
+}
+
+/* Fold the per-cpu refreshes into the fdb entries, called under RCU */
+static void br_fdb_lazy_fold(struct net_bridge *br)
+{
+	struct br_fdb_lazy_slot __percpu *slots = READ_ONCE(br->fdb_lazy);
+	struct net_bridge_fdb_entry *f;
+	struct net_bridge_fdb_key fk;
+	unsigned long updated, used;
+	unsigned int seq;
+	int cpu, i;
+	u64 key;
+
+	if (!slots)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct br_fdb_lazy_slot *slot = per_cpu_ptr(slots, cpu);
+
+		for (i = 0; i < BR_FDB_LAZY_SLOTS; i++, slot++) {
+			do {
+				seq = read_seqcount_begin(&slot->seq);
+				key = slot->key;
+				updated = slot->updated;
+				used = slot->used;
+			} while (read_seqcount_retry(&slot->seq, seq));
+			if (!key)
+				continue;
+
+			memcpy(&fk, &key, sizeof(fk));
+			f = rhashtable_lookup(&br->fdb_hash_tbl, &fk,
+					      br_fdb_rht_params);
+			if (!f)
+				continue;
+
+			if (updated && time_after(updated, f->updated))
+				WRITE_ONCE(f->updated, updated);
+			if (used && time_after(used, f->used))
+				WRITE_ONCE(f->used, used);
+		}
+	}
+}
+
+/* called under rtnl */
+int br_fdb_set_lazy_refresh(struct net_bridge *br, bool on,
+			    struct netlink_ext_ack *extack)
+{
+	struct br_fdb_lazy_slot __percpu *slots;
+	int cpu, i;
+
+	if (on && !br->fdb_lazy) {
+		slots = __alloc_percpu_gfp(sizeof(*slots) * BR_FDB_LAZY_SLOTS,
+					   __alignof__(*slots),
+					   GFP_KERNEL_ACCOUNT);
+		if (!slots) {
+			NL_SET_ERR_MSG_MOD(extack,
+					   "Cannot allocate lazy refresh table");
+			return -ENOMEM;
+		}
+		for_each_possible_cpu(cpu) {
+			struct br_fdb_lazy_slot *slot = per_cpu_ptr(slots, cpu);
+
+			for (i = 0; i < BR_FDB_LAZY_SLOTS; i++)
+				seqcount_init(&slot[i].seq);
+		}
+		/* never freed before the bridge is destroyed */
+		smp_store_release(&br->fdb_lazy, slots);
+	}
+
+	br_opt_toggle(br, BROPT_FDB_LAZY_REFRESH, on);
+
+	return 0;
+}
+
 /* requires bridge hash_lock */
 static struct net_bridge_fdb_entry *br_fdb_find(struct net_bridge *br,
 						const unsigned char *addr,
@@ -554,6 +699,7 @@ void br_fdb_cleanup(struct work_struct *work)
 	 * delayed freeing allowing us to continue traversing
 	 */
 	rcu_read_lock();
+	br_fdb_lazy_fold(br);
 	hlist_for_each_entry_rcu(f, &br->fdb_list, fdb_node) {
 		unsigned long this_timer = f->updated + delay;
 
@@ -911,7 +1057,9 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 			bool fdb_modified = false;
 
 			if (now != fdb->updated) {
-				fdb->updated = now;
+				if (!br_fdb_refresh_deferred(br, fdb, now,
+							     false))
+					fdb->updated = now;
 				fdb_modified = __fdb_mark_active(fdb);
 			}
 
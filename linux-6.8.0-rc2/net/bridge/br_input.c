@@ -202,7 +202,8 @@ int br_handle_frame_finish(struct net *net, struct sock *sk, struct sk_buff *skb
 		if (test_bit(BR_FDB_LOCAL, &dst->flags))
 			return br_pass_frame_up(skb);
 
-		if (now != dst->used)
+		if (now != dst->used &&
+		    !br_fdb_refresh_deferred(br, dst, now, true))
 			dst->used = now;
 		br_forward(dst->dst, skb, local_rcv, false);
 	} else {
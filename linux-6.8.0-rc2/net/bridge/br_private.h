@@ -483,6 +483,7 @@ enum net_bridge_opts {
 	BROPT_VLAN_BRIDGE_BINDING,
 	BROPT_MCAST_VLAN_SNOOPING_ENABLED,
 	BROPT_MST_ENABLED,
+	BROPT_FDB_LAZY_REFRESH,
 };
 
 struct net_bridge {
@@ -555,6 +556,7 @@ struct net_bridge {
 	struct timer_list		tcn_timer;
 	struct timer_list		topology_change_timer;
 	struct delayed_work		gc_work;
+	struct br_fdb_lazy_slot __percpu *fdb_lazy;
 	struct kobject			*ifobj;
 	u32				auto_cnt;
 
@@ -837,6 +839,11 @@ void br_fdb_find_delete_local(struct net_bridge *br,
 void br_fdb_changeaddr(struct net_bridge_port *p, const unsigned char *newaddr);
 void br_fdb_change_mac_address(struct net_bridge *br, const u8 *newaddr);
 void br_fdb_cleanup(struct work_struct *work);
+int br_fdb_set_lazy_refresh(struct net_bridge *br, bool on,
+			    struct netlink_ext_ack *extack);
+bool br_fdb_refresh_deferred(struct net_bridge *br,
+			     struct net_bridge_fdb_entry *fdb,
+			     unsigned long now, bool used);
 void br_fdb_delete_by_port(struct net_bridge *br,
 			   const struct net_bridge_port *p, u16 vid, int do_all);
 struct net_bridge_fdb_entry *br_fdb_find_rcu(struct net_bridge *br,
@@ -103,6 +103,23 @@ get_entry(const void *base, unsigned int offset)
 	return (struct ipt_entry *)(base + offset);
 }
 
+/* Performance critical */
+static inline struct ipt_entry *
+ipt_next_candidate(const struct xt_classifier *cls, const void *base,
+		   const struct ipt_entry *e, const struct iphdr *ip)
+{
+	union nf_inet_addr daddr = { .ip = ip->daddr };
+
+	return get_entry(base, xt_classifier_next(cls, (void *)e - base,
+						  &daddr));
+}
+
+static void ipt_free_table_info(struct xt_table_info *info)
+{
+	xt_classifier_free(info->classifier);
+	xt_free_table_info(info);
+}
+
 /* All zeroes == unconditional rule. */
 /* Mildly perf critical (only if packet tracing is on) */
 static inline bool unconditional(const struct ipt_entry *e)
@@ -235,6 +252,7 @@ ipt_do_table(void *priv,
 	struct ipt_entry *e, **jumpstack;
 	unsigned int stackidx, cpu;
 	const struct xt_table_info *private;
+	const struct xt_classifier *cls;
 	struct xt_action_param acpar;
 	unsigned int addend;
 
@@ -261,6 +279,7 @@ ipt_do_table(void *priv,
 	cpu        = smp_processor_id();
 	table_base = private->entries;
 	jumpstack  = (struct ipt_entry **)private->jumpstack[cpu];
+	cls        = private->classifier;
 
 	/* Switch to alternate jumpstack if we're being invoked via TEE.
 	 * TEE issues XT_CONTINUE verdict on original skb so we must not
@@ -284,6 +303,8 @@ ipt_do_table(void *priv,
 		    &e->ip, acpar.fragoff)) {
  no_match:
 			e = ipt_next_entry(e);
+			if (cls)
+				e = ipt_next_candidate(cls, table_base, e, ip);
 			continue;
 		}
 
@@ -654,6 +675,34 @@ cleanup_entry(struct ipt_entry *e, struct net *net)
 	xt_percpu_counter_free(&e->counters);
 }
 
+/* Compile the destination address classifier for a large table.  Not
+ * having one only costs speed, so failures are ignored.
+ */
+static void ipt_build_classifier(struct xt_table_info *newinfo, void *entry0)
+{
+	struct xt_classifier *c;
+	struct ipt_entry *iter;
+
+	c = xt_classifier_alloc(NFPROTO_IPV4, newinfo->number);
+	if (!c)
+		return;
+
+	xt_entry_foreach(iter, entry0, newinfo->size) {
+		union nf_inet_addr dst = { .ip = iter->ip.dst.s_addr };
+		union nf_inet_addr dmsk = { .ip = iter->ip.dmsk.s_addr };
+
+		xt_classifier_add(c, (void *)iter - entry0, &dst, &dmsk,
+				  iter->ip.invflags & IPT_INV_DSTIP);
+	}
+
+	if (xt_classifier_build(c)) {
+		xt_classifier_free(c);
+		return;
+	}
+
+	newinfo->classifier = c;
+}
+
 /* Checks and translates the user-supplied table segment (held in
    newinfo) */
 static int
@@ -729,6 +778,7 @@ translate_table(struct net *net, struct xt_table_info *newinfo, void *entry0,
 		return ret;
 	}
 
+	ipt_build_classifier(newinfo, entry0);
 	return ret;
  out_free:
 	kvfree(offsets);
@@ -1081,7 +1131,7 @@ __do_replace(struct net *net, const char *name, unsigned int valid_hooks,
 	xt_entry_foreach(iter, oldinfo->entries, oldinfo->size)
 		cleanup_entry(iter, net);
 
-	xt_free_table_info(oldinfo);
+	ipt_free_table_info(oldinfo);
 	if (copy_to_user(counters_ptr, counters,
 			 sizeof(struct xt_counters) * num_counters) != 0) {
 		/* Silent error, can't fail, new table is already in place */
@@ -1144,7 +1194,7 @@ do_replace(struct net *net, sockptr_t arg, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1466,11 +1516,11 @@ translate_compat_table(struct net *net,
 
 	*pinfo = newinfo;
 	*pentry0 = entry1;
-	xt_free_table_info(info);
+	ipt_free_table_info(info);
 	return 0;
 
 free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 out_unlock:
 	xt_compat_flush_offsets(AF_INET);
@@ -1528,7 +1578,7 @@ compat_do_replace(struct net *net, sockptr_t arg, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1709,7 +1759,7 @@ static void __ipt_unregister_table(struct net *net, struct xt_table *table)
 		cleanup_entry(iter, net);
 	if (private->number > private->initial_entries)
 		module_put(table_owner);
-	xt_free_table_info(private);
+	ipt_free_table_info(private);
 }
 
 int ipt_register_table(struct net *net, const struct xt_table *table,
@@ -1733,7 +1783,7 @@ int ipt_register_table(struct net *net, const struct xt_table *table,
 
 	ret = translate_table(net, newinfo, loc_cpu_entry, repl);
 	if (ret != 0) {
-		xt_free_table_info(newinfo);
+		ipt_free_table_info(newinfo);
 		return ret;
 	}
 
@@ -1743,7 +1793,7 @@ int ipt_register_table(struct net *net, const struct xt_table *table,
 
 		xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 			cleanup_entry(iter, net);
-		xt_free_table_info(newinfo);
+		ipt_free_table_info(newinfo);
 		return PTR_ERR(new_table);
 	}
 
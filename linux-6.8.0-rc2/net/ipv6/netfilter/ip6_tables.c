@@ -128,6 +128,23 @@ get_entry(const void *base, unsigned int offset)
 	return (struct ip6t_entry *)(base + offset);
 }
 
+/* Performance critical */
+static inline struct ip6t_entry *
+ip6t_next_candidate(const struct xt_classifier *cls, const void *base,
+		    const struct ip6t_entry *e, const struct sk_buff *skb)
+{
+	union nf_inet_addr daddr = { .in6 = ipv6_hdr(skb)->daddr };
+
+	return get_entry(base, xt_classifier_next(cls, (void *)e - base,
+						  &daddr));
+}
+
+static void ip6t_free_table_info(struct xt_table_info *info)
+{
+	xt_classifier_free(info->classifier);
+	xt_free_table_info(info);
+}
+
 /* All zeroes == unconditional rule. */
 /* Mildly perf critical (only if packet tracing is on) */
 static inline bool unconditional(const struct ip6t_entry *e)
@@ -258,6 +275,7 @@ ip6t_do_table(void *priv, struct sk_buff *skb,
 	struct ip6t_entry *e, **jumpstack;
 	unsigned int stackidx, cpu;
 	const struct xt_table_info *private;
+	const struct xt_classifier *cls;
 	struct xt_action_param acpar;
 	unsigned int addend;
 
@@ -283,6 +301,7 @@ ip6t_do_table(void *priv, struct sk_buff *skb,
 	cpu        = smp_processor_id();
 	table_base = private->entries;
 	jumpstack  = (struct ip6t_entry **)private->jumpstack[cpu];
+	cls        = private->classifier;
 
 	/* Switch to alternate jumpstack if we're being invoked via TEE.
 	 * TEE issues XT_CONTINUE verdict on original skb so we must not
@@ -307,6 +326,9 @@ ip6t_do_table(void *priv, struct sk_buff *skb,
 		    &acpar.thoff, &acpar.fragoff, &acpar.hotdrop)) {
  no_match:
 			e = ip6t_next_entry(e);
+			if (cls)
+				e = ip6t_next_candidate(cls, table_base, e,
+							skb);
 			continue;
 		}
 
@@ -671,6 +693,36 @@ static void cleanup_entry(struct ip6t_entry *e, struct net *net)
 	xt_percpu_counter_free(&e->counters);
 }
 
+/* Compile the destination address classifier for a large table.  Not
+ * having one only costs speed, so failures are ignored.
+ */
+static void ip6t_build_classifier(struct xt_table_info *newinfo, void *entry0)
+{
+	struct xt_classifier *c;
+	struct ip6t_entry *iter;
+
+	c = xt_classifier_alloc(NFPROTO_IPV6, newinfo->number);
+	if (!c)
+		return;
+
+	xt_entry_foreach(iter, entry0, newinfo->size) {
+		union nf_inet_addr dst = { .in6 = iter->ipv6.dst };
+		union nf_inet_addr dmsk = { .in6 = iter->ipv6.dmsk };
+
+		/* ip6_packet_match() masks both sides, unlike IPv4 */
+		nf_inet_addr_mask(&dst, &dst, &dmsk);
+		xt_classifier_add(c, (void *)iter - entry0, &dst, &dmsk,
+				  iter->ipv6.invflags & IP6T_INV_DSTIP);
+	}
+
+	if (xt_classifier_build(c)) {
+		xt_classifier_free(c);
+		return;
+	}
+
+	newinfo->classifier = c;
+}
+
 /* Checks and translates the user-supplied table segment (held in
    newinfo) */
 static int
@@ -746,6 +798,7 @@ translate_table(struct net *net, struct xt_table_info *newinfo, void *entry0,
 		return ret;
 	}
 
+	ip6t_build_classifier(newinfo, entry0);
 	return ret;
  out_free:
 	kvfree(offsets);
@@ -1098,7 +1151,7 @@ __do_replace(struct net *net, const char *name, unsigned int valid_hooks,
 	xt_entry_foreach(iter, oldinfo->entries, oldinfo->size)
 		cleanup_entry(iter, net);
 
-	xt_free_table_info(oldinfo);
+	ip6t_free_table_info(oldinfo);
 	if (copy_to_user(counters_ptr, counters,
 			 sizeof(struct xt_counters) * num_counters) != 0) {
 		/* Silent error, can't fail, new table is already in place */
@@ -1161,7 +1214,7 @@ do_replace(struct net *net, sockptr_t arg, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ip6t_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1475,11 +1528,11 @@ translate_compat_table(struct net *net,
 
 	*pinfo = newinfo;
 	*pentry0 = entry1;
-	xt_free_table_info(info);
+	ip6t_free_table_info(info);
 	return 0;
 
 free_newinfo:
-	xt_free_table_info(newinfo);
+	ip6t_free_table_info(newinfo);
 	return ret;
 out_unlock:
 	xt_compat_flush_offsets(AF_INET6);
@@ -1537,7 +1590,7 @@ compat_do_replace(struct net *net, sockptr_t arg, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ip6t_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1718,7 +1771,7 @@ static void __ip6t_unregister_table(struct net *net, struct xt_table *table)
 		cleanup_entry(iter, net);
 	if (private->number > private->initial_entries)
 		module_put(table_owner);
-	xt_free_table_info(private);
+	ip6t_free_table_info(private);
 }
 
 int ip6t_register_table(struct net *net, const struct xt_table *table,
@@ -1742,7 +1795,7 @@ int ip6t_register_table(struct net *net, const struct xt_table *table,
 
 	ret = translate_table(net, newinfo, loc_cpu_entry, repl);
 	if (ret != 0) {
-		xt_free_table_info(newinfo);
+		ip6t_free_table_info(newinfo);
 		return ret;
 	}
 
@@ -1752,7 +1805,7 @@ int ip6t_register_table(struct net *net, const struct xt_table *table,
 
 		xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 			cleanup_entry(iter, net);
-		xt_free_table_info(newinfo);
+		ip6t_free_table_info(newinfo);
 		return PTR_ERR(new_table);
 	}
 
@@ -32,6 +32,8 @@
 #include <linux/jhash.h>
 #include <linux/random.h>
 #include <linux/rcupdate_wait.h>
+#include <linux/seqlock.h>
+#include <linux/workqueue.h>
 
 #include <net/net_namespace.h>
 #include <net/ip_vs.h>
@@ -43,19 +45,46 @@
 
 /*
  * Connection hash size. Default is what was selected at compile time.
+ * The table grows and shrinks with the number of hashed connections but
+ * never below this size.
 */
 static int ip_vs_conn_tab_bits = CONFIG_IP_VS_TAB_BITS;
 module_param_named(conn_tab_bits, ip_vs_conn_tab_bits, int, 0444);
-MODULE_PARM_DESC(conn_tab_bits, "Set connections' hash size");
+MODULE_PARM_DESC(conn_tab_bits, "Set connections' initial and minimum hash size");
+
+/* upper limit for resizing, depends on the available memory */
+static int ip_vs_conn_tab_max_bits __read_mostly;
 
 /* size and mask values */
 int ip_vs_conn_tab_size __read_mostly;
-static int ip_vs_conn_tab_mask __read_mostly;
+static unsigned int ip_vs_conn_tab_mask __read_mostly;
 
 /*
  *  Connection hash table: for input and output packets lookups of IPVS
  */
-static struct hlist_head *ip_vs_conn_tab __read_mostly;
+static struct hlist_head __rcu *ip_vs_conn_tab __read_mostly;
+
+/* table the entries are moved to while resizing, NULL otherwise */
+static struct hlist_head __rcu *ip_vs_conn_tab_new __read_mostly;
+static unsigned int ip_vs_conn_tab_new_mask __read_mostly;
+
+/* number of connections hashed in ip_vs_conn_tab, for all netns */
+static atomic_t ip_vs_conn_count = ATOMIC_INIT(0);
+
+/*
+ *  Resizing: ip_vs_conn_tab_lock serializes switching tables against the
+ *  bucket locks, ip_vs_conn_tab_seq lets lookups detect that the tables
+ *  were switched under them and ip_vs_conn_tab_mutex keeps the table
+ *  stable for the walkers that sleep between buckets.
+ */
+static DEFINE_SPINLOCK(ip_vs_conn_tab_lock);
+static seqcount_spinlock_t ip_vs_conn_tab_seq =
+	SEQCNT_SPINLOCK_ZERO(ip_vs_conn_tab_seq, &ip_vs_conn_tab_lock);
+static bool ip_vs_conn_tab_locks_all;
+static DEFINE_MUTEX(ip_vs_conn_tab_mutex);
+
+static void ip_vs_conn_tab_resize(struct work_struct *work);
+static DECLARE_WORK(ip_vs_conn_resize_work, ip_vs_conn_tab_resize);
 
 /*  SLAB cache for IPVS connections */
 static struct kmem_cache *ip_vs_conn_cachep __read_mostly;
@@ -69,7 +98,7 @@ static unsigned int ip_vs_conn_rnd __read_mostly;
 /*
  *  Fine locking granularity for big connection hash table
  */
-#define CT_LOCKARRAY_BITS  5
+#define CT_LOCKARRAY_BITS  8
 #define CT_LOCKARRAY_SIZE  (1<<CT_LOCKARRAY_BITS)
 #define CT_LOCKARRAY_MASK  (CT_LOCKARRAY_SIZE-1)
 
@@ -82,16 +111,30 @@ static unsigned int ip_vs_conn_rnd __read_mostly;
 
 struct ip_vs_aligned_lock
 {
-	spinlock_t	l;
+	spinlock_t		l;
+	seqcount_spinlock_t	seq;	/* entries moved to the new table */
 } __attribute__((__aligned__(SMP_CACHE_BYTES)));
 
 /* lock array for conn table */
 static struct ip_vs_aligned_lock
 __ip_vs_conntbl_lock_array[CT_LOCKARRAY_SIZE] __cacheline_aligned;
 
+/* The lock is selected by the unmasked hash key, so that the same lock
+ * protects a connection before and after the table is resized.
+ */
 static inline void ct_write_lock_bh(unsigned int key)
 {
-	spin_lock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
+	spinlock_t *lock = &__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l;
+
+	spin_lock_bh(lock);
+	if (likely(!smp_load_acquire(&ip_vs_conn_tab_locks_all)))
+		return;
+
+	/* a resize is in progress, wait for it on the global lock */
+	spin_unlock(lock);
+	spin_lock(&ip_vs_conn_tab_lock);
+	spin_lock(lock);
+	spin_unlock(&ip_vs_conn_tab_lock);
 }
 
 static inline void ct_write_unlock_bh(unsigned int key)
@@ -99,10 +142,98 @@ static inline void ct_write_unlock_bh(unsigned int key)
 	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
 }
 
+/* Exclude all bucket lock holders, must be called with BHs disabled */
+static void ct_write_lock_all(void)
+{
+	int idx;
+
+	spin_lock(&ip_vs_conn_tab_lock);
+	WRITE_ONCE(ip_vs_conn_tab_locks_all, true);
+
+	/* Wait for the current holders, the unlock makes the flag visible
+	 * to everyone that takes the bucket lock after us.
+	 */
+	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++) {
+		spin_lock(&__ip_vs_conntbl_lock_array[idx].l);
+		spin_unlock(&__ip_vs_conntbl_lock_array[idx].l);
+	}
+}
+
+static void ct_write_unlock_all(void)
+{
+	smp_store_release(&ip_vs_conn_tab_locks_all, false);
+	spin_unlock(&ip_vs_conn_tab_lock);
+}
+
+/* Chains a lookup has to search: while resizing, a connection is either
+ * still in the old table or already in the new one.
+ */
+struct ip_vs_conn_lookup {
+	struct hlist_head	*chain[2];
+	unsigned int		hash;
+	unsigned int		seq;
+	unsigned int		bseq;
+};
+
+#define ip_vs_conn_lookup_for_each(cp, l, i)				\
+	for (i = 0; i < ARRAY_SIZE((l)->chain) && (l)->chain[i]; i++)	\
+		hlist_for_each_entry_rcu(cp, (l)->chain[i], c_list)
+
+/* Get the chains to search for @hash.  Called under RCU. */
+static inline void ip_vs_conn_lookup_begin(struct ip_vs_conn_lookup *l,
+					   unsigned int hash)
+{
+	struct hlist_head *tab, *new_tab;
+	unsigned int mask, new_mask;
+
+	do {
+		l->seq = read_seqcount_begin(&ip_vs_conn_tab_seq);
+		tab = rcu_dereference(ip_vs_conn_tab);
+		mask = ip_vs_conn_tab_mask;
+		new_tab = rcu_dereference(ip_vs_conn_tab_new);
+		new_mask = ip_vs_conn_tab_new_mask;
+	} while (read_seqcount_retry(&ip_vs_conn_tab_seq, l->seq));
+
+	l->chain[0] = &tab[hash & mask];
+	l->chain[1] = new_tab ? &new_tab[hash & new_mask] : NULL;
+	l->hash = hash;
+	l->bseq = read_seqcount_begin(
+		&__ip_vs_conntbl_lock_array[hash & CT_LOCKARRAY_MASK].seq);
+}
+
+/* A miss is not reliable if entries of our chain were moved to the new
+ * table, or the tables were switched, meanwhile.
+ */
+static inline bool ip_vs_conn_lookup_retry(const struct ip_vs_conn_lookup *l)
+{
+	return read_seqcount_retry(
+			&__ip_vs_conntbl_lock_array[l->hash & CT_LOCKARRAY_MASK].seq,
+			l->bseq) ||
+	       read_seqcount_retry(&ip_vs_conn_tab_seq, l->seq);
+}
+
+/* Table used by the walkers, ip_vs_conn_tab_mutex must be held */
+static inline struct hlist_head *ip_vs_conn_tab_walk(void)
+{
+	return rcu_dereference_protected(ip_vs_conn_tab,
+				lockdep_is_held(&ip_vs_conn_tab_mutex));
+}
+
+static inline void ip_vs_conn_tab_check_size(int count)
+{
+	int size = READ_ONCE(ip_vs_conn_tab_size);
+
+	if ((unlikely(count > size && size < (1 << ip_vs_conn_tab_max_bits)) ||
+	     unlikely(count < size / 8 && size > (1 << ip_vs_conn_tab_bits))) &&
+	    !work_pending(&ip_vs_conn_resize_work))
+		queue_work(system_unbound_wq, &ip_vs_conn_resize_work);
+}
+
 static void ip_vs_conn_expire(struct timer_list *t);
 
 /*
- *	Returns hash value for IPVS connection entry
+ *	Returns hash value for IPVS connection entry, not yet masked by the
+ *	current table size
  */
 static unsigned int ip_vs_conn_hashkey(struct netns_ipvs *ipvs, int af, unsigned int proto,
 				       const union nf_inet_addr *addr,
@@ -110,13 +241,13 @@ static unsigned int ip_vs_conn_hashkey(struct netns_ipvs *ipvs, int af, unsigned
 {
 #ifdef CONFIG_IP_VS_IPV6
 	if (af == AF_INET6)
-		return (jhash_3words(jhash(addr, 16, ip_vs_conn_rnd),
+		return jhash_3words(jhash(addr, 16, ip_vs_conn_rnd),
 				    (__force u32)port, proto, ip_vs_conn_rnd) ^
-			((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+			((size_t)ipvs>>8);
 #endif
-	return (jhash_3words((__force u32)addr->ip, (__force u32)port, proto,
+	return jhash_3words((__force u32)addr->ip, (__force u32)port, proto,
 			    ip_vs_conn_rnd) ^
-		((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+		((size_t)ipvs>>8);
 }
 
 static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
@@ -126,8 +257,7 @@ static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
 	__be16 port;
 
 	if (p->pe_data && p->pe->hashkey_raw)
-		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse) &
-			ip_vs_conn_tab_mask;
+		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse);
 
 	if (likely(!inverse)) {
 		addr = p->caddr;
@@ -162,7 +292,8 @@ static unsigned int ip_vs_conn_hashkey_conn(const struct ip_vs_conn *cp)
  */
 static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 {
-	unsigned int hash;
+	struct hlist_head *tab;
+	unsigned int hash, mask;
 	int ret;
 
 	if (cp->flags & IP_VS_CONN_F_ONE_PACKET)
@@ -175,10 +306,19 @@ static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 	spin_lock(&cp->lock);
 
 	if (!(cp->flags & IP_VS_CONN_F_HASHED)) {
+		/* tables can not be switched while we hold a bucket lock,
+		 * new entries go to the new table while resizing
+		 */
+		tab = rcu_dereference_protected(ip_vs_conn_tab_new, 1);
+		mask = ip_vs_conn_tab_new_mask;
+		if (!tab) {
+			tab = rcu_dereference_protected(ip_vs_conn_tab, 1);
+			mask = ip_vs_conn_tab_mask;
+		}
 		cp->flags |= IP_VS_CONN_F_HASHED;
 		refcount_inc(&cp->refcnt);
-		hlist_add_head_rcu(&cp->c_list, &ip_vs_conn_tab[hash]);
-		ret = 1;
+		hlist_add_head_rcu(&cp->c_list, &tab[hash & mask]);
+		ret = atomic_inc_return(&ip_vs_conn_count);
 	} else {
 		pr_err("%s(): request for already hashed, called from %pS\n",
 		       __func__, __builtin_return_address(0));
@@ -188,7 +328,10 @@ static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 	spin_unlock(&cp->lock);
 	ct_write_unlock_bh(hash);
 
-	return ret;
+	if (ret)
+		ip_vs_conn_tab_check_size(ret);
+
+	return !!ret;
 }
 
 
@@ -211,6 +354,7 @@ static inline int ip_vs_conn_unhash(struct ip_vs_conn *cp)
 		hlist_del_rcu(&cp->c_list);
 		cp->flags &= ~IP_VS_CONN_F_HASHED;
 		refcount_dec(&cp->refcnt);
+		atomic_dec(&ip_vs_conn_count);
 		ret = 1;
 	} else
 		ret = 0;
@@ -249,6 +393,9 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 	spin_unlock(&cp->lock);
 	ct_write_unlock_bh(hash);
 
+	if (ret)
+		ip_vs_conn_tab_check_size(atomic_dec_return(&ip_vs_conn_count));
+
 	return ret;
 }
 
@@ -262,14 +409,18 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 static inline struct ip_vs_conn *
 __ip_vs_conn_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	struct ip_vs_conn_lookup l;
 	struct ip_vs_conn *cp;
+	unsigned int hash;
+	int i;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
+begin:
+	ip_vs_conn_lookup_begin(&l, hash);
+	ip_vs_conn_lookup_for_each(cp, &l, i) {
 		if (p->cport == cp->cport && p->vport == cp->vport &&
 		    cp->af == p->af &&
 		    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
@@ -285,6 +436,9 @@ __ip_vs_conn_in_get(const struct ip_vs_conn_param *p)
 		}
 	}
 
+	if (ip_vs_conn_lookup_retry(&l))
+		goto begin;
+
 	rcu_read_unlock();
 
 	return NULL;
@@ -348,14 +502,18 @@ EXPORT_SYMBOL_GPL(ip_vs_conn_in_get_proto);
 /* Get reference to connection template */
 struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	struct ip_vs_conn_lookup l;
 	struct ip_vs_conn *cp;
+	unsigned int hash;
+	int i;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
+begin:
+	ip_vs_conn_lookup_begin(&l, hash);
+	ip_vs_conn_lookup_for_each(cp, &l, i) {
 		if (unlikely(p->pe_data && p->pe->ct_match)) {
 			if (cp->ipvs != p->ipvs)
 				continue;
@@ -380,6 +538,8 @@ struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
 				goto out;
 		}
 	}
+	if (ip_vs_conn_lookup_retry(&l))
+		goto begin;
 	cp = NULL;
 
   out:
@@ -400,10 +560,12 @@ struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
  *	p->vaddr, p->vport: pkt dest address (foreign host) */
 struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
 	struct ip_vs_conn *cp, *ret=NULL;
 	const union nf_inet_addr *saddr;
+	struct ip_vs_conn_lookup l;
+	unsigned int hash;
 	__be16 sport;
+	int i;
 
 	/*
 	 *	Check for "full" addressed entries
@@ -412,7 +574,9 @@ struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
+begin:
+	ip_vs_conn_lookup_begin(&l, hash);
+	ip_vs_conn_lookup_for_each(cp, &l, i) {
 		if (p->vport != cp->cport)
 			continue;
 
@@ -433,10 +597,14 @@ struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 				continue;
 			/* HIT */
 			ret = cp;
-			break;
+			goto out;
 		}
 	}
 
+	if (ip_vs_conn_lookup_retry(&l))
+		goto begin;
+
+out:
 	rcu_read_unlock();
 
 	IP_VS_DBG_BUF(9, "lookup/out %s %s:%d->%s:%d %s\n",
@@ -1040,6 +1208,94 @@ ip_vs_conn_new(const struct ip_vs_conn_param *p, int dest_af,
 	return cp;
 }
 
+/* Publish or retire ip_vs_conn_tab_new, excluding bucket lock holders */
+static void ip_vs_conn_tab_switch(struct hlist_head *tab, unsigned int mask,
+				  struct hlist_head *new_tab,
+				  unsigned int new_mask)
+{
+	local_bh_disable();
+	ct_write_lock_all();
+	write_seqcount_begin(&ip_vs_conn_tab_seq);
+
+	ip_vs_conn_tab_mask = mask;
+	rcu_assign_pointer(ip_vs_conn_tab, tab);
+	ip_vs_conn_tab_new_mask = new_mask;
+	rcu_assign_pointer(ip_vs_conn_tab_new, new_tab);
+
+	write_seqcount_end(&ip_vs_conn_tab_seq);
+	ct_write_unlock_all();
+	local_bh_enable();
+}
+
+/*
+ *	Resize ip_vs_conn_tab to about twice the number of hashed connections.
+ *
+ *	Both tables are live while the entries are moved one bucket at a time:
+ *	new connections are hashed into the new table and lookups search the
+ *	old chain, then the new one.  Tables are never smaller than the lock
+ *	array, so all entries of an old bucket and the buckets they move to
+ *	share one bucket lock.  Its seqcount tells lookups that walked that
+ *	chain while entries were being moved to retry on a miss.
+ */
+static void ip_vs_conn_tab_resize(struct work_struct *work)
+{
+	struct hlist_head *old_tab, *new_tab;
+	int bits, old_size, new_size, idx;
+	struct ip_vs_aligned_lock *lock;
+	struct ip_vs_conn *cp;
+	unsigned int hash;
+
+	bits = order_base_2(atomic_read(&ip_vs_conn_count)) + 1;
+	bits = clamp(bits, ip_vs_conn_tab_bits, ip_vs_conn_tab_max_bits);
+	new_size = 1 << bits;
+
+	mutex_lock(&ip_vs_conn_tab_mutex);
+	old_size = ip_vs_conn_tab_size;
+	if (new_size == old_size)
+		goto out;
+
+	new_tab = kvmalloc_array(new_size, sizeof(*new_tab), GFP_KERNEL);
+	if (!new_tab)
+		goto out;
+	for (idx = 0; idx < new_size; idx++)
+		INIT_HLIST_HEAD(&new_tab[idx]);
+
+	old_tab = ip_vs_conn_tab_walk();
+	ip_vs_conn_tab_switch(old_tab, old_size - 1, new_tab, new_size - 1);
+
+	for (idx = 0; idx < old_size; idx++) {
+		lock = &__ip_vs_conntbl_lock_array[idx & CT_LOCKARRAY_MASK];
+
+		spin_lock_bh(&lock->l);
+		write_seqcount_begin(&lock->seq);
+		while (!hlist_empty(&old_tab[idx])) {
+			cp = hlist_entry(old_tab[idx].first,
+					 struct ip_vs_conn, c_list);
+			hash = ip_vs_conn_hashkey_conn(cp) & (new_size - 1);
+			hlist_del_rcu(&cp->c_list);
+			hlist_add_head_rcu(&cp->c_list, &new_tab[hash]);
+		}
+		write_seqcount_end(&lock->seq);
+		spin_unlock_bh(&lock->l);
+
+		cond_resched();
+	}
+
+	ip_vs_conn_tab_switch(new_tab, new_size - 1, NULL, 0);
+	WRITE_ONCE(ip_vs_conn_tab_size, new_size);
+	mutex_unlock(&ip_vs_conn_tab_mutex);
+
+	IP_VS_DBG(2, "Connection hash table resized (size=%d->%d)\n",
+		  old_size, new_size);
+
+	synchronize_net();
+	kvfree(old_tab);
+	return;
+
+out:
+	mutex_unlock(&ip_vs_conn_tab_mutex);
+}
+
 /*
  *	/proc/net/ip_vs_conn entries
  */
@@ -1054,14 +1310,15 @@ static void *ip_vs_conn_array(struct seq_file *seq, loff_t pos)
 	int idx;
 	struct ip_vs_conn *cp;
 	struct ip_vs_iter_state *iter = seq->private;
+	struct hlist_head *tab = ip_vs_conn_tab_walk();
 
 	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+		hlist_for_each_entry_rcu(cp, &tab[idx], c_list) {
 			/* __ip_vs_conn_get() is not needed by
 			 * ip_vs_conn_seq_show and ip_vs_conn_sync_seq_show
 			 */
 			if (pos-- == 0) {
-				iter->l = &ip_vs_conn_tab[idx];
+				iter->l = &tab[idx];
 				return cp;
 			}
 		}
@@ -1077,6 +1334,8 @@ static void *ip_vs_conn_seq_start(struct seq_file *seq, loff_t *pos)
 	struct ip_vs_iter_state *iter = seq->private;
 
 	iter->l = NULL;
+	/* the table must not be resized while we sleep between buckets */
+	mutex_lock(&ip_vs_conn_tab_mutex);
 	rcu_read_lock();
 	return *pos ? ip_vs_conn_array(seq, *pos - 1) :SEQ_START_TOKEN;
 }
@@ -1085,6 +1344,7 @@ static void *ip_vs_conn_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 {
 	struct ip_vs_conn *cp = v;
 	struct ip_vs_iter_state *iter = seq->private;
+	struct hlist_head *tab = ip_vs_conn_tab_walk();
 	struct hlist_node *e;
 	struct hlist_head *l = iter->l;
 	int idx;
@@ -1098,10 +1358,10 @@ static void *ip_vs_conn_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 	if (e)
 		return hlist_entry(e, struct ip_vs_conn, c_list);
 
-	idx = l - ip_vs_conn_tab;
+	idx = l - tab;
 	while (++idx < ip_vs_conn_tab_size) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
-			iter->l = &ip_vs_conn_tab[idx];
+		hlist_for_each_entry_rcu(cp, &tab[idx], c_list) {
+			iter->l = &tab[idx];
 			return cp;
 		}
 		cond_resched_rcu();
@@ -1114,6 +1374,7 @@ static void ip_vs_conn_seq_stop(struct seq_file *seq, void *v)
 	__releases(RCU)
 {
 	rcu_read_unlock();
+	mutex_unlock(&ip_vs_conn_tab_mutex);
 }
 
 static int ip_vs_conn_seq_show(struct seq_file *seq, void *v)
@@ -1302,7 +1563,10 @@ void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
 {
 	int idx;
 	struct ip_vs_conn *cp;
+	struct hlist_head *tab;
 
+	mutex_lock(&ip_vs_conn_tab_mutex);
+	tab = ip_vs_conn_tab_walk();
 	rcu_read_lock();
 	/*
 	 * Randomly scan 1/32 of the whole table every second
@@ -1310,7 +1574,7 @@ void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
 	for (idx = 0; idx < (ip_vs_conn_tab_size>>5); idx++) {
 		unsigned int hash = get_random_u32() & ip_vs_conn_tab_mask;
 
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
+		hlist_for_each_entry_rcu(cp, &tab[hash], c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 			if (atomic_read(&cp->n_control))
@@ -1362,6 +1626,7 @@ drop:
 		cond_resched_rcu();
 	}
 	rcu_read_unlock();
+	mutex_unlock(&ip_vs_conn_tab_mutex);
 }
 
 
@@ -1372,12 +1637,15 @@ static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 {
 	int idx;
 	struct ip_vs_conn *cp, *cp_c;
+	struct hlist_head *tab;
 
 flush_again:
+	mutex_lock(&ip_vs_conn_tab_mutex);
+	tab = ip_vs_conn_tab_walk();
 	rcu_read_lock();
 	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
 
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+		hlist_for_each_entry_rcu(cp, &tab[idx], c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 			if (atomic_read(&cp->n_control))
@@ -1393,6 +1661,7 @@ flush_again:
 		cond_resched_rcu();
 	}
 	rcu_read_unlock();
+	mutex_unlock(&ip_vs_conn_tab_mutex);
 
 	/* the counter may be not NULL, because maybe some conn entries
 	   are run by slow timer handler or unhashed but still referred */
@@ -1408,10 +1677,13 @@ void ip_vs_expire_nodest_conn_flush(struct netns_ipvs *ipvs)
 	int idx;
 	struct ip_vs_conn *cp, *cp_c;
 	struct ip_vs_dest *dest;
+	struct hlist_head *tab;
 
+	mutex_lock(&ip_vs_conn_tab_mutex);
+	tab = ip_vs_conn_tab_walk();
 	rcu_read_lock();
 	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+		hlist_for_each_entry_rcu(cp, &tab[idx], c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 
@@ -1437,6 +1709,7 @@ void ip_vs_expire_nodest_conn_flush(struct netns_ipvs *ipvs)
 			break;
 	}
 	rcu_read_unlock();
+	mutex_unlock(&ip_vs_conn_tab_mutex);
 }
 #endif
 
@@ -1481,6 +1754,7 @@ void __net_exit ip_vs_conn_net_cleanup(struct netns_ipvs *ipvs)
 
 int __init ip_vs_conn_init(void)
 {
+	struct hlist_head *tab;
 	size_t tab_array_size;
 	int max_avail;
 #if BITS_PER_LONG > 32
@@ -1488,7 +1762,8 @@ int __init ip_vs_conn_init(void)
 #else
 	int max = 20;
 #endif
-	int min = 8;
+	/* resizing relies on tables being at least as big as the lock array */
+	int min = CT_LOCKARRAY_BITS;
 	int idx;
 
 	max_avail = order_base_2(totalram_pages()) + PAGE_SHIFT;
@@ -1497,17 +1772,16 @@ int __init ip_vs_conn_init(void)
 	max_avail -= order_base_2(sizeof(struct ip_vs_conn));
 	max = clamp(max, min, max_avail);
 	ip_vs_conn_tab_bits = clamp_val(ip_vs_conn_tab_bits, min, max);
+	ip_vs_conn_tab_max_bits = max;
 	ip_vs_conn_tab_size = 1 << ip_vs_conn_tab_bits;
 	ip_vs_conn_tab_mask = ip_vs_conn_tab_size - 1;
 
 	/*
 	 * Allocate the connection hash table and initialize its list heads
 	 */
-	tab_array_size = array_size(ip_vs_conn_tab_size,
-				    sizeof(*ip_vs_conn_tab));
-	ip_vs_conn_tab = kvmalloc_array(ip_vs_conn_tab_size,
-					sizeof(*ip_vs_conn_tab), GFP_KERNEL);
-	if (!ip_vs_conn_tab)
+	tab_array_size = array_size(ip_vs_conn_tab_size, sizeof(*tab));
+	tab = kvmalloc_array(ip_vs_conn_tab_size, sizeof(*tab), GFP_KERNEL);
+	if (!tab)
 		return -ENOMEM;
 
 	/* Allocate ip_vs_conn slab cache */
@@ -1515,20 +1789,24 @@ int __init ip_vs_conn_init(void)
 					      sizeof(struct ip_vs_conn), 0,
 					      SLAB_HWCACHE_ALIGN, NULL);
 	if (!ip_vs_conn_cachep) {
-		kvfree(ip_vs_conn_tab);
+		kvfree(tab);
 		return -ENOMEM;
 	}
 
-	pr_info("Connection hash table configured (size=%d, memory=%zdKbytes)\n",
-		ip_vs_conn_tab_size, tab_array_size / 1024);
+	pr_info("Connection hash table configured (size=%d, memory=%zdKbytes, max size=%d)\n",
+		ip_vs_conn_tab_size, tab_array_size / 1024,
+		1 << ip_vs_conn_tab_max_bits);
 	IP_VS_DBG(0, "Each connection entry needs %zd bytes at least\n",
 		  sizeof(struct ip_vs_conn));
 
 	for (idx = 0; idx < ip_vs_conn_tab_size; idx++)
-		INIT_HLIST_HEAD(&ip_vs_conn_tab[idx]);
+		INIT_HLIST_HEAD(&tab[idx]);
+	RCU_INIT_POINTER(ip_vs_conn_tab, tab);
 
 	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++)  {
 		spin_lock_init(&__ip_vs_conntbl_lock_array[idx].l);
+		seqcount_spinlock_init(&__ip_vs_conntbl_lock_array[idx].seq,
+				       &__ip_vs_conntbl_lock_array[idx].l);
 	}
 
 	/* calculate the random value for connection hash */
@@ -1539,9 +1817,10 @@ int __init ip_vs_conn_init(void)
 
 void ip_vs_conn_cleanup(void)
 {
+	cancel_work_sync(&ip_vs_conn_resize_work);
 	/* Wait all ip_vs_conn_rcu_free() callbacks to complete */
 	rcu_barrier();
 	/* Release the empty cache */
 	kmem_cache_destroy(ip_vs_conn_cachep);
-	kvfree(ip_vs_conn_tab);
+	kvfree(rcu_dereference_protected(ip_vs_conn_tab, 1));
 }
@@ -0,0 +1,340 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Destination address classifier for large x_tables rule sets.
+ *
+ * ip_tables and ip6_tables walk their chains rule by rule.  Rule sets
+ * generated by service proxies consist of thousands of rules that only
+ * differ in their destination address, so most of that walk is spent on
+ * rules that fail the very first test of ip_packet_match().
+ *
+ * When a table is loaded, the rules are sorted into a few groups by the
+ * prefix length of their destination mask (a tuple space search over one
+ * dimension).  Rules with an inverted, non-prefix or empty destination
+ * mask, or whose prefix length did not get a group, are wildcards.  For a
+ * packet standing at a given rule, xt_classifier_next() returns the first
+ * rule at or after it that is either a wildcard or whose destination
+ * equals the packet's one under the group mask.  Everything in between
+ * fails the destination test and would not have matched anyway, so the
+ * result is identical to the linear walk, including counters.  Every
+ * chain ends with an unconditional rule, which is a wildcard, so the
+ * search never leaves the chain it started in.
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/x_tables.h>
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("x_tables destination address classifier");
+
+#define XT_CLASSIFIER_MAX_GROUPS	8
+#define XT_CLASSIFIER_MAX_PLEN		128
+
+static unsigned int min_rules __read_mostly = 256;
+module_param(min_rules, uint, 0644);
+MODULE_PARM_DESC(min_rules,
+		 "Minimum number of classified rules to compile a table (0 disables)");
+
+struct xt_classifier_ent {
+	union nf_inet_addr	addr;
+	unsigned int		pos;
+};
+
+struct xt_classifier_group {
+	union nf_inet_addr		mask;
+	unsigned int			count;
+	struct xt_classifier_ent	*ents;
+};
+
+struct xt_classifier {
+	unsigned int		number;		/* rules in the table */
+	unsigned int		added;
+	unsigned int		words;		/* 32 bit address words */
+	unsigned int		ngroups;
+	unsigned int		*offsets;	/* rule offset by position */
+	unsigned int		*next_wild;	/* next wildcard position */
+	/* only needed until xt_classifier_build() */
+	u8			*plen;		/* 0 for wildcards */
+	union nf_inet_addr	*dst;
+	struct xt_classifier_group groups[XT_CLASSIFIER_MAX_GROUPS];
+};
+
+/* Prefix length of mask @m, or -1 if it is not a prefix */
+static int xt_classifier_plen(const union nf_inet_addr *m, unsigned int words)
+{
+	unsigned int i, len = 0;
+	u32 w;
+
+	for (i = 0; i < words; i++) {
+		w = ntohl(m->all[i]);
+		if (w == ~0U) {
+			len += 32;
+			continue;
+		}
+		/* ~w must be of the form 2^n - 1 */
+		if (~w & (~w + 1))
+			return -1;
+		len += 32 - fls(~w);
+		while (++i < words)
+			if (m->all[i])
+				return -1;
+		break;
+	}
+
+	return len;
+}
+
+static void xt_classifier_prefix(union nf_inet_addr *m, unsigned int plen)
+{
+	unsigned int i;
+
+	memset(m, 0, sizeof(*m));
+	for (i = 0; plen; i++) {
+		unsigned int n = min(plen, 32U);
+
+		m->all[i] = htonl(~0U << (32 - n));
+		plen -= n;
+	}
+}
+
+/**
+ * xt_classifier_alloc - start compiling a table
+ * @af:		NFPROTO_IPV4 or NFPROTO_IPV6
+ * @number:	number of rules in the table
+ *
+ * Returns NULL if the table is too small to bother or on allocation
+ * failure, the caller then keeps evaluating the table linearly.
+ */
+struct xt_classifier *xt_classifier_alloc(u_int8_t af, unsigned int number)
+{
+	unsigned int min = READ_ONCE(min_rules);
+	struct xt_classifier *c;
+
+	if (!min || number < min)
+		return NULL;
+
+	c = kzalloc(sizeof(*c), GFP_KERNEL_ACCOUNT);
+	if (!c)
+		return NULL;
+
+	c->number = number;
+	c->words = af == NFPROTO_IPV6 ? 4 : 1;
+	c->offsets = kvmalloc_array(number, sizeof(*c->offsets),
+				    GFP_KERNEL_ACCOUNT);
+	c->next_wild = kvmalloc_array(number + 1, sizeof(*c->next_wild),
+				      GFP_KERNEL_ACCOUNT);
+	c->plen = kvmalloc_array(number, sizeof(*c->plen), GFP_KERNEL);
+	c->dst = kvmalloc_array(number, sizeof(*c->dst), GFP_KERNEL);
+	if (!c->offsets || !c->next_wild || !c->plen || !c->dst) {
+		xt_classifier_free(c);
+		return NULL;
+	}
+
+	return c;
+}
+EXPORT_SYMBOL_GPL(xt_classifier_alloc);
+
+/**
+ * xt_classifier_add - add the next rule of the table
+ * @c:		classifier from xt_classifier_alloc()
+ * @offset:	offset of the rule in the table
+ * @dst:	destination address of the rule
+ * @dmsk:	destination mask of the rule
+ * @wildcard:	rule can not be classified, e.g. inverted destination
+ *
+ * Rules must be added in table order.
+ */
+void xt_classifier_add(struct xt_classifier *c, unsigned int offset,
+		       const union nf_inet_addr *dst,
+		       const union nf_inet_addr *dmsk, bool wildcard)
+{
+	unsigned int pos = c->added++;
+	int plen;
+
+	if (WARN_ON_ONCE(pos >= c->number))
+		return;
+
+	c->offsets[pos] = offset;
+	plen = wildcard ? 0 : xt_classifier_plen(dmsk, c->words);
+	c->plen[pos] = max(plen, 0);
+	memset(&c->dst[pos], 0, sizeof(c->dst[pos]));
+	memcpy(&c->dst[pos], dst, c->words * sizeof(__be32));
+}
+EXPORT_SYMBOL_GPL(xt_classifier_add);
+
+static int xt_classifier_ent_cmp(const void *a, const void *b)
+{
+	const struct xt_classifier_ent *ea = a, *eb = b;
+	int ret;
+
+	ret = memcmp(&ea->addr, &eb->addr, sizeof(ea->addr));
+	if (ret)
+		return ret;
+
+	return ea->pos < eb->pos ? -1 : ea->pos > eb->pos;
+}
+
+/**
+ * xt_classifier_build - finish compiling a table
+ * @c:	classifier with all rules added
+ *
+ * Returns 0 on success.  On error the classifier must be freed and the
+ * table evaluated linearly.
+ */
+int xt_classifier_build(struct xt_classifier *c)
+{
+	unsigned int count[XT_CLASSIFIER_MAX_PLEN + 1] = {};
+	unsigned int i, j, best, classified = 0;
+	u8 group_of[XT_CLASSIFIER_MAX_PLEN + 1] = {};
+
+	if (c->added != c->number)
+		return -EINVAL;
+
+	for (i = 0; i < c->number; i++)
+		count[c->plen[i]]++;
+
+	/* Give groups to the most common prefix lengths, 0 is wildcard */
+	while (c->ngroups < XT_CLASSIFIER_MAX_GROUPS) {
+		best = 0;
+		for (j = 1; j <= XT_CLASSIFIER_MAX_PLEN; j++)
+			if (!group_of[j] && count[j] &&
+			    (!best || count[j] > count[best]))
+				best = j;
+		if (!best)
+			break;
+
+		group_of[best] = ++c->ngroups;
+		xt_classifier_prefix(&c->groups[c->ngroups - 1].mask, best);
+		classified += count[best];
+	}
+
+	if (classified < READ_ONCE(min_rules))
+		return -EOPNOTSUPP;
+
+	for (i = 0; i < c->ngroups; i++) {
+		struct xt_classifier_group *g = &c->groups[i];
+
+		for (j = 0; j <= XT_CLASSIFIER_MAX_PLEN; j++)
+			if (group_of[j] == i + 1)
+				break;
+
+		g->ents = kvmalloc_array(count[j], sizeof(*g->ents),
+					 GFP_KERNEL_ACCOUNT);
+		if (!g->ents)
+			return -ENOMEM;
+	}
+
+	c->next_wild[c->number] = c->number;
+	for (i = c->number; i-- > 0;) {
+		unsigned int grp = group_of[c->plen[i]];
+		struct xt_classifier_group *g;
+
+		if (!grp) {
+			c->next_wild[i] = i;
+			continue;
+		}
+		c->next_wild[i] = c->next_wild[i + 1];
+
+		g = &c->groups[grp - 1];
+		g->ents[g->count].addr = c->dst[i];
+		g->ents[g->count].pos = i;
+		g->count++;
+	}
+
+	for (i = 0; i < c->ngroups; i++)
+		sort(c->groups[i].ents, c->groups[i].count,
+		     sizeof(struct xt_classifier_ent),
+		     xt_classifier_ent_cmp, NULL);
+
+	kvfree(c->plen);
+	c->plen = NULL;
+	kvfree(c->dst);
+	c->dst = NULL;
+
+	pr_debug("%u rules, %u classified in %u groups\n",
+		 c->number, classified, c->ngroups);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xt_classifier_build);
+
+/**
+ * xt_classifier_next - find the next rule that can match
+ * @c:		classifier of the table
+ * @offset:	offset of the rule the packet is at
+ * @daddr:	destination address of the packet
+ *
+ * Returns the offset of the first rule at or after @offset whose
+ * destination test can succeed for @daddr.
+ *
+ * Performance critical - called for every non matching rule.
+ */
+unsigned int xt_classifier_next(const struct xt_classifier *c,
+				unsigned int offset,
+				const union nf_inet_addr *daddr)
+{
+	unsigned int lo, hi, mid, pos, best, i;
+	struct xt_classifier_ent key;
+
+	lo = 0;
+	hi = c->number;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (c->offsets[mid] < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (unlikely(lo == c->number || c->offsets[lo] != offset))
+		return offset;
+
+	pos = lo;
+	best = c->next_wild[pos];
+	if (best == pos)
+		return offset;
+
+	key.pos = pos;
+
+	for (i = 0; i < c->ngroups; i++) {
+		const struct xt_classifier_group *g = &c->groups[i];
+
+		nf_inet_addr_mask(daddr, &key.addr, &g->mask);
+
+		/* first entry not less than (addr, pos) */
+		lo = 0;
+		hi = g->count;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (xt_classifier_ent_cmp(&g->ents[mid], &key) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		if (lo < g->count && g->ents[lo].pos < best &&
+		    !memcmp(&g->ents[lo].addr, &key.addr, sizeof(key.addr)))
+			best = g->ents[lo].pos;
+	}
+
+	return likely(best < c->number) ? c->offsets[best] : offset;
+}
+EXPORT_SYMBOL_GPL(xt_classifier_next);
+
+void xt_classifier_free(struct xt_classifier *c)
+{
+	unsigned int i;
+
+	if (!c)
+		return;
+
+	for (i = 0; i < c->ngroups; i++)
+		kvfree(c->groups[i].ents);
+	kvfree(c->dst);
+	kvfree(c->plen);
+	kvfree(c->next_wild);
+	kvfree(c->offsets);
+	kfree(c);
+}
+EXPORT_SYMBOL_GPL(xt_classifier_free);
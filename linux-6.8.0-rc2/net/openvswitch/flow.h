@@ -8,6 +8,7 @@
 
 #include <linux/cache.h>
 #include <linux/kernel.h>
+#include <linux/llist.h>
 #include <linux/netlink.h>
 #include <linux/openvswitch.h>
 #include <linux/spinlock.h>
@@ -219,7 +220,7 @@ struct sw_flow_stats {
 };
 
 struct sw_flow {
-	struct rcu_head rcu;
+	struct llist_node reclaim_node;	/* See ovs_flow_free(). */
 	struct {
 		struct hlist_node node[2];
 		u32 hash;
@@ -227,6 +228,7 @@ struct sw_flow {
 	int stats_last_writer;		/* CPU id of the last writer on
 					 * 'stats[0]'.
 					 */
+	bool dead;			/* Removed from its flow table. */
 	struct sw_flow_key key;
 	struct sw_flow_id id;
 	struct cpumask *cpu_used_mask;
@@ -30,6 +30,7 @@
 #include <linux/icmpv6.h>
 #include <linux/rculist.h>
 #include <linux/sort.h>
+#include <linux/workqueue.h>
 #include <net/ip.h>
 #include <net/ipv6.h>
 #include <net/ndisc.h>
@@ -42,6 +43,9 @@
 #define MC_HASH_SHIFT		8
 #define MC_HASH_SEGS		((sizeof(uint32_t) * 8) / MC_HASH_SHIFT)
 
+#define EMC_ENTRIES		512 /* Must be ^2 value. */
+#define EMC_RECLAIM_DELAY	(HZ / 10)
+
 static struct kmem_cache *flow_cache;
 struct kmem_cache *flow_stats_cache __read_mostly;
 
@@ -125,22 +129,43 @@ static void flow_free(struct sw_flow *flow)
 	kmem_cache_free(flow_cache, flow);
 }
 
-static void rcu_free_flow_callback(struct rcu_head *rcu)
+/* Removed flows waiting to be freed.  An exact-match cache entry may
+ * still point to them, so they are freed in batches, once the cache
+ * generation has moved on and an RCU grace period has passed.
+ */
+static LLIST_HEAD(flow_reclaim_list);
+static unsigned long flow_emc_gen;
+
+static void flow_reclaim_work_fn(struct work_struct *work)
 {
-	struct sw_flow *flow = container_of(rcu, struct sw_flow, rcu);
+	struct llist_node *list = llist_del_all(&flow_reclaim_list);
+	struct sw_flow *flow, *next;
 
-	flow_free(flow);
+	/* Pairs with smp_load_acquire() in ovs_flow_tbl_lookup_stats(): a
+	 * lookup that sees the new generation cannot find these flows, and
+	 * entries stored with an older one are never dereferenced again.
+	 */
+	smp_store_release(&flow_emc_gen, flow_emc_gen + 1);
+	synchronize_rcu();
+
+	llist_for_each_entry_safe(flow, next, list, reclaim_node)
+		flow_free(flow);
 }
 
+static DECLARE_DELAYED_WORK(flow_reclaim_work, flow_reclaim_work_fn);
+
 void ovs_flow_free(struct sw_flow *flow, bool deferred)
 {
 	if (!flow)
 		return;
 
-	if (deferred)
-		call_rcu(&flow->rcu, rcu_free_flow_callback);
-	else
+	if (deferred) {
+		if (llist_add(&flow->reclaim_node, &flow_reclaim_list))
+			schedule_delayed_work(&flow_reclaim_work,
+					      EMC_RECLAIM_DELAY);
+	} else {
 		flow_free(flow);
+	}
 }
 
 static void __table_instance_destroy(struct table_instance *ti)
@@ -430,6 +455,12 @@ int ovs_flow_tbl_init(struct flow_table *table)
 	if (!ufid_ti)
 		goto free_ti;
 
+	table->emc = __alloc_percpu(array_size(sizeof(struct emc_entry),
+					       EMC_ENTRIES),
+				    __alignof__(struct emc_entry));
+	if (!table->emc)
+		goto free_ufid_ti;
+
 	rcu_assign_pointer(table->ti, ti);
 	rcu_assign_pointer(table->ufid_ti, ufid_ti);
 	rcu_assign_pointer(table->mask_array, ma);
@@ -439,6 +470,8 @@ int ovs_flow_tbl_init(struct flow_table *table)
 	table->ufid_count = 0;
 	return 0;
 
+free_ufid_ti:
+	__table_instance_destroy(ufid_ti);
 free_ti:
 	__table_instance_destroy(ti);
 free_mask_array:
@@ -470,6 +503,12 @@ static void table_instance_flow_free(struct flow_table *table,
 	}
 
 	flow_mask_remove(table, flow->mask);
+
+	/* Only this flow's exact-match cache entries go stale, the others
+	 * stay valid.  ovs_flow_free() keeps the memory around for as long
+	 * as an entry may point to it.
+	 */
+	WRITE_ONCE(flow->dead, true);
 }
 
 /* Must be called with OVS mutex held. */
@@ -517,6 +556,7 @@ void ovs_flow_tbl_destroy(struct flow_table *table)
 	struct mask_cache *mc = rcu_dereference_raw(table->mask_cache);
 	struct mask_array *ma = rcu_dereference_raw(table->mask_array);
 
+	free_percpu(table->emc);
 	call_rcu(&mc->rcu, mask_cache_rcu_cb);
 	call_rcu(&ma->rcu, mask_array_rcu_cb);
 	table_instance_destroy(ti, ufid_ti);
@@ -684,6 +724,27 @@ static bool flow_cmp_masked_key(const struct sw_flow *flow,
 	return cmp_key(&flow->key, key, range->start, range->end);
 }
 
+/* Compare an unmasked packet 'key' against 'flow', applying the flow's mask
+ * on the fly instead of building a masked copy of the whole key first.
+ */
+static bool flow_cmp_packet_key(const struct sw_flow *flow,
+				const struct sw_flow_key *key)
+{
+	const struct sw_flow_mask *mask = flow->mask;
+	int key_start = mask->range.start;
+	int key_end = mask->range.end;
+	const long *m = (const long *)((const u8 *)&mask->key + key_start);
+	const long *fp = (const long *)((const u8 *)&flow->key + key_start);
+	const long *kp = (const long *)((const u8 *)key + key_start);
+	int i;
+
+	for (i = key_start; i < key_end; i += sizeof(long))
+		if ((*kp++ & *m++) ^ *fp++)
+			return false;
+
+	return true;
+}
+
 static bool ovs_flow_cmp_unmasked_key(const struct sw_flow *flow,
 				      const struct sw_flow_match *match)
 {
@@ -779,6 +840,10 @@ static struct sw_flow *flow_lookup(struct flow_table *tbl,
  * cache entry in mask cache.
  * This is per cpu cache and is divided in MC_HASH_SEGS segments.
  * In case of a hash collision the entry is hashed in next segment.
+ *
+ * In front of it sits a small per cpu exact-match cache mapping skb_hash
+ * directly to a flow, which skips the masked hash lookup altogether for
+ * established connections.
  * */
 struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 					  const struct sw_flow_key *key,
@@ -790,7 +855,9 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	struct mask_array *ma = rcu_dereference(tbl->mask_array);
 	struct table_instance *ti = rcu_dereference(tbl->ti);
 	struct mask_cache_entry *entries, *ce;
+	struct emc_entry *emc;
 	struct sw_flow *flow;
+	unsigned long gen;
 	u32 hash;
 	int seg;
 
@@ -810,6 +877,21 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	if (key->recirc_id)
 		skb_hash = jhash_1word(skb_hash, key->recirc_id);
 
+	/* Exact-match cache: the flow last seen with this skb_hash on this
+	 * CPU, unless it has been removed since.  The generation must be
+	 * sampled before the masked lookup below so that a flow freed
+	 * concurrently is never cached as current.
+	 */
+	gen = smp_load_acquire(&flow_emc_gen);
+	emc = this_cpu_ptr(tbl->emc) + (skb_hash & (EMC_ENTRIES - 1));
+	if (emc->skb_hash == skb_hash && emc->gen == gen && emc->flow &&
+	    !READ_ONCE(emc->flow->dead) &&
+	    flow_cmp_packet_key(emc->flow, key)) {
+		*n_mask_hit = 1;
+		*n_cache_hit = 1;
+		return emc->flow;
+	}
+
 	ce = NULL;
 	hash = skb_hash;
 	entries = this_cpu_ptr(mc->mask_cache);
@@ -825,7 +907,7 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 					   n_cache_hit, &e->mask_index);
 			if (!flow)
 				e->skb_hash = 0;
-			return flow;
+			goto out;
 		}
 
 		if (!ce || e->skb_hash < ce->skb_hash)
@@ -841,6 +923,12 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 		ce->skb_hash = skb_hash;
 
 	*n_cache_hit = 0;
+out:
+	if (flow) {
+		emc->skb_hash = skb_hash;
+		emc->gen = gen;
+		emc->flow = flow;
+	}
 	return flow;
 }
 
@@ -1215,6 +1303,7 @@ int ovs_flow_init(void)
 /* Uninitializes the flow module. */
 void ovs_flow_exit(void)
 {
+	flush_delayed_work(&flow_reclaim_work);
 	kmem_cache_destroy(flow_stats_cache);
 	kmem_cache_destroy(flow_cache);
 }
@@ -33,6 +33,15 @@ struct mask_cache {
 	struct mask_cache_entry __percpu *mask_cache;
 };
 
+/* Exact-match cache entry.  'gen' is the exact-match cache generation at
+ * the time 'flow' was stored; a mismatch means 'flow' may have been freed.
+ */
+struct emc_entry {
+	u32 skb_hash;
+	unsigned long gen;
+	struct sw_flow *flow;
+};
+
 struct mask_count {
 	int index;
 	u64 counter;
@@ -64,6 +73,7 @@ struct flow_table {
 	struct table_instance __rcu *ufid_ti;
 	struct mask_cache __rcu *mask_cache;
 	struct mask_array __rcu *mask_array;
+	struct emc_entry __percpu *emc;
 	unsigned long last_rehash;
 	unsigned int count;
 	unsigned int ufid_count;
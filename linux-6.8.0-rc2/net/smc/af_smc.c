@@ -45,6 +45,7 @@
 #include "smc_core.h"
 #include "smc_ib.h"
 #include "smc_ism.h"
+#include "smc_loopback.h"
 #include "smc_pnet.h"
 #include "smc_netlink.h"
 #include "smc_tx.h"
@@ -3490,10 +3491,14 @@ static int __init smc_init(void)
 		goto out_pernet_subsys_stat;
 	smc_clc_init();
 
-	rc = smc_nl_init();
+	rc = smc_loopback_init();
 	if (rc)
 		goto out_ism;
 
+	rc = smc_nl_init();
+	if (rc)
+		goto out_lo;
+
 	rc = smc_pnet_init();
 	if (rc)
 		goto out_nl;
@@ -3585,6 +3590,8 @@ out_pnet:
 	smc_pnet_exit();
 out_nl:
 	smc_nl_exit();
+out_lo:
+	smc_loopback_exit();
 out_ism:
 	smc_clc_exit();
 	smc_ism_exit();
@@ -3604,6 +3611,7 @@ static void __exit smc_exit(void)
 	smc_core_exit();
 	smc_ib_unregister_client();
 	smc_ism_exit();
+	smc_loopback_exit();
 	destroy_workqueue(smc_close_wq);
 	destroy_workqueue(smc_tcp_ls_wq);
 	destroy_workqueue(smc_hs_wq);
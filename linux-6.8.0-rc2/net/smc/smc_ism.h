@@ -14,6 +14,7 @@
 #include <linux/mutex.h>
 
 #include "smc.h"
+#include "smc_loopback.h"
 
 #define SMC_VIRTUAL_ISM_CHID_MASK	0xFF00
 #define SMC_ISM_IDENT_MASK		0x00FFFF
@@ -52,6 +53,7 @@ int smc_ism_signal_shutdown(struct smc_link_group *lgr);
 void smc_ism_get_system_eid(u8 **eid);
 u16 smc_ism_get_chid(struct smcd_dev *dev);
 bool smc_ism_is_v2_capable(void);
+void smc_ism_set_v2_capable(void);
 int smc_ism_init(void);
 void smc_ism_exit(void);
 int smcd_nl_get_device(struct sk_buff *skb, struct netlink_callback *cb);
@@ -84,4 +86,9 @@ static inline bool smc_ism_is_virtual(struct smcd_dev *smcd)
 	return __smc_ism_is_virtual(chid);
 }
 
+static inline bool smc_ism_is_loopback(struct smcd_dev *smcd)
+{
+	return smcd->ops->get_chid(smcd) == SMC_LO_RESERVED_CHID;
+}
+
 #endif
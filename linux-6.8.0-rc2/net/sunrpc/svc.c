@@ -36,6 +36,7 @@
 #define RPCDBG_FACILITY	RPCDBG_SVCDSP
 
 static void svc_unregister(const struct svc_serv *serv, struct net *net);
+static void svc_spawn_threads_work(struct work_struct *work);
 
 #define SVC_POOL_DEFAULT	SVC_POOL_GLOBAL
 
@@ -487,6 +488,8 @@ __svc_create(struct svc_program *prog, unsigned int bufsize, int npools,
 	INIT_LIST_HEAD(&serv->sv_permsocks);
 	timer_setup(&serv->sv_temptimer, NULL, 0);
 	spin_lock_init(&serv->sv_lock);
+	mutex_init(&serv->sv_thread_mutex);
+	INIT_WORK(&serv->sv_spawn_work, svc_spawn_threads_work);
 
 	__svc_init_bc(serv);
 
@@ -509,10 +512,14 @@ __svc_create(struct svc_program *prog, unsigned int bufsize, int npools,
 		lwq_init(&pool->sp_xprts);
 		INIT_LIST_HEAD(&pool->sp_all_threads);
 		init_llist_head(&pool->sp_idle_threads);
+		spin_lock_init(&pool->sp_idle_lock);
 
 		percpu_counter_init(&pool->sp_messages_arrived, 0, GFP_KERNEL);
 		percpu_counter_init(&pool->sp_sockets_queued, 0, GFP_KERNEL);
 		percpu_counter_init(&pool->sp_threads_woken, 0, GFP_KERNEL);
+		percpu_counter_init(&pool->sp_threads_timedout, 0, GFP_KERNEL);
+		percpu_counter_init(&pool->sp_threads_spawned, 0, GFP_KERNEL);
+		percpu_counter_init(&pool->sp_threads_retired, 0, GFP_KERNEL);
 	}
 
 	return serv;
@@ -572,6 +579,7 @@ svc_destroy(struct svc_serv **servp)
 
 	dprintk("svc: svc_destroy(%s)\n", serv->sv_program->pg_name);
 	timer_shutdown_sync(&serv->sv_temptimer);
+	cancel_work_sync(&serv->sv_spawn_work);
 
 	/*
 	 * Remaining transports at this point are not expected.
@@ -591,6 +599,9 @@ svc_destroy(struct svc_serv **servp)
 		percpu_counter_destroy(&pool->sp_messages_arrived);
 		percpu_counter_destroy(&pool->sp_sockets_queued);
 		percpu_counter_destroy(&pool->sp_threads_woken);
+		percpu_counter_destroy(&pool->sp_threads_timedout);
+		percpu_counter_destroy(&pool->sp_threads_spawned);
+		percpu_counter_destroy(&pool->sp_threads_retired);
 	}
 	kfree(serv->sv_pools);
 	kfree(serv);
@@ -676,16 +687,15 @@ svc_prepare_thread(struct svc_serv *serv, struct svc_pool *pool, int node)
 	if (!rqstp)
 		return ERR_PTR(-ENOMEM);
 
-	spin_lock_bh(&serv->sv_lock);
-	serv->sv_nrthreads += 1;
-	spin_unlock_bh(&serv->sv_lock);
-
 	atomic_inc(&pool->sp_nrthreads);
 
-	/* Protected by whatever lock the service uses when calling
-	 * svc_set_num_threads()
+	/* Threads that retire on their own leave sp_all_threads without
+	 * holding sv_thread_mutex, so updates need sv_lock too.
 	 */
+	spin_lock_bh(&serv->sv_lock);
+	serv->sv_nrthreads += 1;
 	list_add_rcu(&rqstp->rq_all, &pool->sp_all_threads);
+	spin_unlock_bh(&serv->sv_lock);
 
 	return rqstp;
 }
@@ -815,6 +825,25 @@ svc_stop_kthreads(struct svc_serv *serv, struct svc_pool *pool, int nrservs)
 	return 0;
 }
 
+/*
+ * A thread that retired because it was idle may still be on its way
+ * out. Let it finish, so the thread counts are stable and nobody else
+ * is using SP_VICTIM_REMAINS.
+ */
+static void
+svc_wait_for_retired_threads(struct svc_serv *serv, struct svc_pool *pool)
+{
+	unsigned int i;
+
+	if (pool) {
+		wait_on_bit(&pool->sp_flags, SP_VICTIM_REMAINS, TASK_IDLE);
+		return;
+	}
+	for (i = 0; i < serv->sv_nrpools; i++)
+		wait_on_bit(&serv->sv_pools[i].sp_flags, SP_VICTIM_REMAINS,
+			    TASK_IDLE);
+}
+
 /**
  * svc_set_num_threads - adjust number of threads per RPC service
  * @serv: RPC service to adjust
@@ -826,6 +855,10 @@ svc_stop_kthreads(struct svc_serv *serv, struct svc_pool *pool, int nrservs)
  * otherwise, round-robin between all pools for @serv. @serv's
  * sv_nrthreads is adjusted for each thread created or destroyed.
  *
+ * The resulting number of threads in each pool affected also becomes
+ * the number below which idle threads are never retired when
+ * sv_nrthrmax allows threads to be started on demand.
+ *
  * Caller must ensure mutual exclusion between this and server startup or
  * shutdown.
  *
@@ -835,19 +868,113 @@ svc_stop_kthreads(struct svc_serv *serv, struct svc_pool *pool, int nrservs)
 int
 svc_set_num_threads(struct svc_serv *serv, struct svc_pool *pool, int nrservs)
 {
+	unsigned int i;
+	int err = 0;
+
+	mutex_lock(&serv->sv_thread_mutex);
+	svc_wait_for_retired_threads(serv, pool);
+
 	if (!pool)
 		nrservs -= serv->sv_nrthreads;
 	else
 		nrservs -= atomic_read(&pool->sp_nrthreads);
 
 	if (nrservs > 0)
-		return svc_start_kthreads(serv, pool, nrservs);
-	if (nrservs < 0)
-		return svc_stop_kthreads(serv, pool, nrservs);
-	return 0;
+		err = svc_start_kthreads(serv, pool, nrservs);
+	else if (nrservs < 0)
+		err = svc_stop_kthreads(serv, pool, nrservs);
+
+	if (pool)
+		pool->sp_nrthrmin = atomic_read(&pool->sp_nrthreads);
+	else
+		for (i = 0; i < serv->sv_nrpools; i++)
+			serv->sv_pools[i].sp_nrthrmin =
+				atomic_read(&serv->sv_pools[i].sp_nrthreads);
+	mutex_unlock(&serv->sv_thread_mutex);
+	return err;
 }
 EXPORT_SYMBOL_GPL(svc_set_num_threads);
 
+/**
+ * svc_pool_try_spawn_thread - start one more thread in a busy pool
+ * @serv: RPC service
+ * @pool: pool in which a transport had to wait for a thread
+ *
+ * Called by a service thread when work waited on @pool's ready queue
+ * for too long while no thread was idle. The thread is started from
+ * sv_spawn_work, so the caller goes on with its request straight away.
+ */
+void svc_pool_try_spawn_thread(struct svc_serv *serv, struct svc_pool *pool)
+{
+	if (!test_and_set_bit(SP_NEED_THREAD, &pool->sp_flags))
+		queue_work(system_unbound_wq, &serv->sv_spawn_work);
+}
+
+/*
+ * A new thread is started in each pool that asked for one, as long as
+ * @serv is below sv_nrthrmax. A service without threads is on its way
+ * down and doesn't get any.
+ */
+static void svc_spawn_threads_work(struct work_struct *work)
+{
+	struct svc_serv *serv = container_of(work, struct svc_serv,
+					     sv_spawn_work);
+	unsigned int i;
+
+	mutex_lock(&serv->sv_thread_mutex);
+	for (i = 0; i < serv->sv_nrpools; i++) {
+		struct svc_pool *pool = &serv->sv_pools[i];
+
+		if (!test_and_clear_bit(SP_NEED_THREAD, &pool->sp_flags))
+			continue;
+		if (!serv->sv_nrthreads ||
+		    serv->sv_nrthreads >= READ_ONCE(serv->sv_nrthrmax))
+			continue;
+		if (svc_start_kthreads(serv, pool, 1) == 0) {
+			percpu_counter_inc(&pool->sp_threads_spawned);
+			trace_svc_pool_thread_spawned(pool, serv->sv_nrthreads);
+		}
+	}
+	mutex_unlock(&serv->sv_thread_mutex);
+}
+
+/**
+ * svc_pool_try_retire_thread - let an idle thread exit
+ * @rqstp: thread that has been idle for a while
+ *
+ * A thread that timed out waiting for work may exit as long as its
+ * pool keeps at least sp_nrthrmin threads, and never fewer than one.
+ * The retiring thread takes the victim role that svc_stop_kthreads()
+ * normally hands out, so svc_exit_thread() needs no special casing.
+ *
+ * Return values:
+ *   %true: caller should exit via svc_exit_thread()
+ *   %false: caller should keep waiting for work
+ */
+bool svc_pool_try_retire_thread(struct svc_rqst *rqstp)
+{
+	struct svc_serv *serv = rqstp->rq_server;
+	struct svc_pool *pool = rqstp->rq_pool;
+	bool retired = false;
+
+	if (!READ_ONCE(serv->sv_nrthrmax))
+		return false;
+	if (!mutex_trylock(&serv->sv_thread_mutex))
+		return false;
+
+	if (atomic_read(&pool->sp_nrthreads) > max(pool->sp_nrthrmin, 1U) &&
+	    !test_and_set_bit(SP_VICTIM_REMAINS, &pool->sp_flags)) {
+		set_bit(RQ_VICTIM, &rqstp->rq_flags);
+		percpu_counter_inc(&pool->sp_threads_retired);
+		trace_svc_pool_thread_retired(pool,
+					      atomic_read(&pool->sp_nrthreads));
+		retired = true;
+	}
+
+	mutex_unlock(&serv->sv_thread_mutex);
+	return retired;
+}
+
 /**
  * svc_rqst_replace_page - Replace one page in rq_pages[]
  * @rqstp: svc_rqst with pages to replace
@@ -924,11 +1051,10 @@ svc_exit_thread(struct svc_rqst *rqstp)
 	struct svc_serv	*serv = rqstp->rq_server;
 	struct svc_pool	*pool = rqstp->rq_pool;
 
-	list_del_rcu(&rqstp->rq_all);
-
 	atomic_dec(&pool->sp_nrthreads);
 
 	spin_lock_bh(&serv->sv_lock);
+	list_del_rcu(&rqstp->rq_all);
 	serv->sv_nrthreads -= 1;
 	spin_unlock_bh(&serv->sv_lock);
 	svc_sock_update_bufs(serv);
@@ -26,6 +26,17 @@
 static unsigned int svc_rpc_per_connection_limit __read_mostly;
 module_param(svc_rpc_per_connection_limit, uint, 0644);
 
+/*
+ * When a service may start threads on demand (sv_nrthrmax is set), a
+ * transport that waits longer than this on the ready queue while no
+ * thread is idle causes another thread to be started. Threads that
+ * find no work for svc_thread_idle_timeout seconds exit again.
+ */
+static unsigned int svc_thread_spawn_delay_us __read_mostly = 1000;
+module_param(svc_thread_spawn_delay_us, uint, 0644);
+static unsigned int svc_thread_idle_timeout __read_mostly = 30;
+module_param(svc_thread_idle_timeout, uint, 0644);
+
 
 static struct svc_deferred_req *svc_deferred_dequeue(struct svc_xprt *xprt);
 static int svc_deferred_recv(struct svc_rqst *rqstp);
@@ -46,7 +57,7 @@ static LIST_HEAD(svc_xprt_class_list);
 
 /* SMP locking strategy:
  *
- *	svc_pool->sp_lock protects most of the fields of that pool.
+ *	svc_pool->sp_idle_lock serialises removal from sp_idle_threads.
  *	svc_serv->sv_lock protects sv_tempsocks, sv_permsocks, sv_tmpcnt.
  *	when both need to be taken (rare), svc_serv->sv_lock is first.
  *	The "service mutex" protects svc_serv->sv_nrthread.
@@ -470,6 +481,11 @@ void svc_xprt_enqueue(struct svc_xprt *xprt)
 
 	pool = svc_pool_for_cpu(xprt->xpt_server);
 
+	/*
+	 * Stamped even with dynamic threads off, so a transport queued
+	 * before they were enabled doesn't look like it waited forever.
+	 */
+	xprt->xpt_qtime = ktime_get();
 	percpu_counter_inc(&pool->sp_sockets_queued);
 	lwq_enqueue(&xprt->xpt_ready, &pool->sp_xprts);
 
@@ -712,27 +728,68 @@ svc_thread_should_sleep(struct svc_rqst *rqstp)
 	return true;
 }
 
-static void svc_thread_wait_for_work(struct svc_rqst *rqstp)
+/*
+ * Take @rqstp off the idle list. Only the head can be removed unless
+ * @anywhere is set, as only the head is ever woken for work. Threads
+ * add themselves without the lock, but all removals take it, so that
+ * the predecessor of an entry can't leave the list while the entry is
+ * unlinked behind it.
+ */
+static bool svc_thread_leave_idle(struct svc_rqst *rqstp, bool anywhere)
+{
+	struct svc_pool *pool = rqstp->rq_pool;
+	struct llist_node *node = &rqstp->rq_idle, *pos;
+	bool ret;
+
+	spin_lock(&pool->sp_idle_lock);
+	ret = llist_del_first_this(&pool->sp_idle_threads, node);
+	if (!ret && anywhere) {
+		/* llist_add() only ever changes ->first */
+		for (pos = READ_ONCE(pool->sp_idle_threads.first); pos;
+		     pos = pos->next) {
+			if (pos->next == node) {
+				WRITE_ONCE(pos->next, node->next);
+				ret = true;
+				break;
+			}
+		}
+	}
+	spin_unlock(&pool->sp_idle_lock);
+	return ret;
+}
+
+/*
+ * Returns true if the thread slept for svc_thread_idle_timeout seconds
+ * without being woken. Threads only time out when the service may
+ * start threads on demand. A thread that timed out leaves the idle
+ * list wherever it is on it, so that it can retire.
+ */
+static bool svc_thread_wait_for_work(struct svc_rqst *rqstp)
 {
 	struct svc_pool *pool = rqstp->rq_pool;
+	long timeout = MAX_SCHEDULE_TIMEOUT;
+	bool timedout = false;
+
+	if (READ_ONCE(rqstp->rq_server->sv_nrthrmax))
+		timeout = READ_ONCE(svc_thread_idle_timeout) * HZ ?:
+			  MAX_SCHEDULE_TIMEOUT;
 
 	if (svc_thread_should_sleep(rqstp)) {
 		set_current_state(TASK_IDLE | TASK_FREEZABLE);
 		llist_add(&rqstp->rq_idle, &pool->sp_idle_threads);
 		if (likely(svc_thread_should_sleep(rqstp)))
-			schedule();
+			timedout = !schedule_timeout(timeout);
 
-		while (!llist_del_first_this(&pool->sp_idle_threads,
-					     &rqstp->rq_idle)) {
+		while (!svc_thread_leave_idle(rqstp, timedout)) {
 			/* Work just became available.  This thread can only
 			 * handle it after removing rqstp from the idle
 			 * list. If that attempt failed, some other thread
 			 * must have queued itself after finding no
 			 * work to do, so that thread has taken responsibly
 			 * for this new work.  This thread can safely sleep
-			 * until woken again.
+			 * until woken again, or until it times out.
 			 */
-			schedule();
+			timedout = !schedule_timeout(timeout);
 			set_current_state(TASK_IDLE | TASK_FREEZABLE);
 		}
 		__set_current_state(TASK_RUNNING);
@@ -740,6 +797,22 @@ static void svc_thread_wait_for_work(struct svc_rqst *rqstp)
 		cond_resched();
 	}
 	try_to_freeze();
+	return timedout;
+}
+
+/*
+ * Did @xprt wait on the ready queue long enough, with no thread idle,
+ * that @pool could use another thread?
+ */
+static bool svc_pool_is_starved(struct svc_pool *pool,
+				const struct svc_xprt *xprt)
+{
+	if (!READ_ONCE(xprt->xpt_server->sv_nrthrmax))
+		return false;
+	if (READ_ONCE(pool->sp_idle_threads.first))
+		return false;
+	return ktime_us_delta(ktime_get(), xprt->xpt_qtime) >
+		READ_ONCE(svc_thread_spawn_delay_us);
 }
 
 static void svc_add_new_temp_xprt(struct svc_serv *serv, struct svc_xprt *newxpt)
@@ -845,7 +918,12 @@ void svc_recv(struct svc_rqst *rqstp)
 	if (!svc_alloc_arg(rqstp))
 		return;
 
-	svc_thread_wait_for_work(rqstp);
+	if (svc_thread_wait_for_work(rqstp)) {
+		percpu_counter_inc(&pool->sp_threads_timedout);
+		if (svc_thread_should_sleep(rqstp) &&
+		    svc_pool_try_retire_thread(rqstp))
+			return;
+	}
 
 	clear_bit(SP_TASK_PENDING, &pool->sp_flags);
 
@@ -858,6 +936,8 @@ void svc_recv(struct svc_rqst *rqstp)
 	if (rqstp->rq_xprt) {
 		struct svc_xprt *xprt = rqstp->rq_xprt;
 
+		if (svc_pool_is_starved(pool, xprt))
+			svc_pool_try_spawn_thread(rqstp->rq_server, pool);
 		svc_thread_wake_next(rqstp);
 		/* Normally we will wait up to 5 seconds for any required
 		 * cache information to be provided.  When there are no
@@ -1416,15 +1496,18 @@ static int svc_pool_stats_show(struct seq_file *m, void *p)
 	struct svc_pool *pool = p;
 
 	if (p == SEQ_START_TOKEN) {
-		seq_puts(m, "# pool packets-arrived sockets-enqueued threads-woken threads-timedout\n");
+		seq_puts(m, "# pool packets-arrived sockets-enqueued threads-woken threads-timedout threads-spawned threads-retired\n");
 		return 0;
 	}
 
-	seq_printf(m, "%u %llu %llu %llu 0\n",
+	seq_printf(m, "%u %llu %llu %llu %llu %llu %llu\n",
 		   pool->sp_id,
 		   percpu_counter_sum_positive(&pool->sp_messages_arrived),
 		   percpu_counter_sum_positive(&pool->sp_sockets_queued),
-		   percpu_counter_sum_positive(&pool->sp_threads_woken));
+		   percpu_counter_sum_positive(&pool->sp_threads_woken),
+		   percpu_counter_sum_positive(&pool->sp_threads_timedout),
+		   percpu_counter_sum_positive(&pool->sp_threads_spawned),
+		   percpu_counter_sum_positive(&pool->sp_threads_retired));
 
 	return 0;
 }
@@ -117,6 +117,7 @@
 #include <linux/file.h>
 #include <linux/btf_ids.h>
 #include <linux/bpf-cgroup.h>
+#include <linux/errqueue.h>
 
 #include "scm.h"
 
@@ -580,6 +581,7 @@ static void unix_sock_destructor(struct sock *sk)
 	struct unix_sock *u = unix_sk(sk);
 
 	skb_queue_purge(&sk->sk_receive_queue);
+	skb_queue_purge(&sk->sk_error_queue);
 
 	DEBUG_NET_WARN_ON_ONCE(refcount_read(&sk->sk_wmem_alloc));
 	DEBUG_NET_WARN_ON_ONCE(!sk_unhashed(sk));
@@ -795,6 +797,33 @@ static int unix_set_peek_off(struct sock *sk, int val)
 	return 0;
 }
 
+/* Stream sockets handle SO_ZEROCOPY themselves, the generic code only
+ * allows it for the inet and RDS families.
+ */
+static int unix_stream_setsockopt(struct socket *sock, int level, int optname,
+				  sockptr_t optval, unsigned int optlen)
+{
+	int val;
+
+	if (level != SOL_SOCKET)
+		return -EOPNOTSUPP;
+
+	if (optname != SO_ZEROCOPY)
+		return sock_setsockopt(sock, level, optname, optval, optlen);
+
+	if (optlen < sizeof(val))
+		return -EINVAL;
+
+	if (copy_from_sockptr(&val, optval, sizeof(val)))
+		return -EFAULT;
+
+	if (val < 0 || val > 1)
+		return -EINVAL;
+
+	sock_valbool_flag(sock->sk, SOCK_ZEROCOPY, val);
+	return 0;
+}
+
 #ifdef CONFIG_PROC_FS
 static int unix_count_nr_fds(struct sock *sk)
 {
@@ -858,6 +887,7 @@ static const struct proto_ops unix_stream_ops = {
 	.listen =	unix_listen,
 	.shutdown =	unix_shutdown,
 	.sendmsg =	unix_stream_sendmsg,
+	.setsockopt =	unix_stream_setsockopt,
 	.recvmsg =	unix_stream_recvmsg,
 	.read_skb =	unix_stream_read_skb,
 	.mmap =		sock_no_mmap,
@@ -1028,6 +1058,7 @@ static int unix_create(struct net *net, struct socket *sock, int protocol,
 	switch (sock->type) {
 	case SOCK_STREAM:
 		sock->ops = &unix_stream_ops;
+		set_bit(SOCK_CUSTOM_SOCKOPT, &sock->flags);
 		break;
 		/*
 		 *	Believe it or not BSD has AF_UNIX, SOCK_RAW though
@@ -1742,6 +1773,7 @@ static int unix_accept(struct socket *sock, struct socket *newsock, int flags,
 	unix_state_lock(tsk);
 	newsock->state = SS_CONNECTED;
 	unix_sock_inherit_flags(sock, newsock);
+	set_bit(SOCK_CUSTOM_SOCKOPT, &newsock->flags);
 	sock_graft(tsk, newsock);
 	unix_state_unlock(tsk);
 	return 0;
@@ -2187,11 +2219,38 @@ static int queue_oob(struct socket *sock, struct msghdr *msg, struct sock *other
 }
 #endif
 
+/* Pin up to @size bytes of the sender's pages into @skb instead of copying
+ * them.  Like spliced pages they are charged to the sender's sk_wmem_alloc,
+ * and @uarg reports their release on the sender's error queue.
+ */
+static int unix_stream_zerocopy_from_iter(struct sk_buff *skb,
+					  struct msghdr *msg, int size,
+					  struct ubuf_info *uarg)
+{
+	int err;
+
+	/* Passing the socket would charge the pages as TCP memory */
+	err = __zerocopy_sg_from_iter(NULL, NULL, skb, &msg->msg_iter, size);
+
+	/* Out of frags, the rest goes into the next skb */
+	if (err == -EMSGSIZE && skb->len)
+		err = 0;
+
+	if (err) {
+		iov_iter_revert(&msg->msg_iter, skb->len);
+		return err;
+	}
+
+	skb_zcopy_set(skb, uarg, NULL);
+	return skb->len;
+}
+
 static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			       size_t len)
 {
 	struct sock *sk = sock->sk;
 	struct sock *other = NULL;
+	struct ubuf_info *uarg = NULL;
 	int err, size;
 	struct sk_buff *skb;
 	int sent = 0;
@@ -2227,10 +2286,27 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (sk->sk_shutdown & SEND_SHUTDOWN)
 		goto pipe_err;
 
+	if ((msg->msg_flags & MSG_ZEROCOPY) && len &&
+	    !(msg->msg_flags & MSG_SPLICE_PAGES) &&
+	    sock_flag(sk, SOCK_ZEROCOPY)) {
+		uarg = msg_zerocopy_realloc(sk, len, NULL);
+		if (!uarg) {
+			err = -ENOBUFS;
+			goto out_err;
+		}
+	}
+
 	while (sent < len) {
 		size = len - sent;
 
 		if (unlikely(msg->msg_flags & MSG_SPLICE_PAGES)) {
+			skb = sock_alloc_send_pskb(sk, 0, 0,
+						   msg->msg_flags & MSG_DONTWAIT,
+						   &err, 0);
+		} else if (uarg) {
+			/* The pinned pages are charged to sk_wmem_alloc too */
+			size = min_t(int, size, (sk->sk_sndbuf >> 1) - 64);
+
 			skb = sock_alloc_send_pskb(sk, 0, 0,
 						   msg->msg_flags & MSG_DONTWAIT,
 						   &err, 0);
@@ -2269,6 +2345,13 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			}
 			size = err;
 			refcount_add(size, &sk->sk_wmem_alloc);
+		} else if (uarg) {
+			err = unix_stream_zerocopy_from_iter(skb, msg, size, uarg);
+			if (err < 0) {
+				kfree_skb(skb);
+				goto out_err;
+			}
+			size = err;
 		} else {
 			skb_put(skb, size - data_len);
 			skb->data_len = data_len;
@@ -2303,6 +2386,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	}
 #endif
 
+	net_zcopy_put(uarg);
 	scm_destroy(&scm);
 
 	return sent;
@@ -2315,6 +2399,10 @@ pipe_err:
 		send_sig(SIGPIPE, current, 0);
 	err = -EPIPE;
 out_err:
+	if (sent)
+		net_zcopy_put(uarg);
+	else
+		net_zcopy_put_abort(uarg, true);
 	scm_destroy(&scm);
 	return sent ? : err;
 }
@@ -2630,10 +2718,28 @@ static struct sk_buff *manage_oob(struct sk_buff *skb, struct sock *sk,
 
 static int unix_stream_read_skb(struct sock *sk, skb_read_actor_t recv_actor)
 {
+	struct unix_sock *u = unix_sk(sk);
+	struct sk_buff *skb;
+	int err;
+
 	if (unlikely(sk->sk_state != TCP_ESTABLISHED))
 		return -ENOTCONN;
 
-	return unix_read_skb(sk, recv_actor);
+	mutex_lock(&u->iolock);
+	skb = skb_recv_datagram(sk, MSG_DONTWAIT, &err);
+	mutex_unlock(&u->iolock);
+	if (!skb)
+		return err;
+
+	/* The actor may queue the skb on another socket indefinitely, do
+	 * not let it hold on to the sender's MSG_ZEROCOPY pages.
+	 */
+	if (skb_orphan_frags_rx(skb, GFP_KERNEL)) {
+		kfree_skb(skb);
+		return -ENOMEM;
+	}
+
+	return recv_actor(sk, skb);
 }
 
 static int unix_stream_read_generic(struct unix_stream_read_state *state,
@@ -2892,10 +2998,16 @@ static int unix_stream_recvmsg(struct socket *sock, struct msghdr *msg,
 		.flags = flags
 	};
 
-#ifdef CONFIG_BPF_SYSCALL
 	struct sock *sk = sock->sk;
-	const struct proto *prot = READ_ONCE(sk->sk_prot);
+#ifdef CONFIG_BPF_SYSCALL
+	const struct proto *prot;
+#endif
+
+	if (unlikely(flags & MSG_ERRQUEUE))
+		return sock_recv_errqueue(sk, msg, size, SOL_UNIX, UNIX_RECVERR);
 
+#ifdef CONFIG_BPF_SYSCALL
+	prot = READ_ONCE(sk->sk_prot);
 	if (prot != &unix_stream_proto)
 		return prot->recvmsg(sk, msg, size, flags, NULL);
 #endif
@@ -2906,6 +3018,12 @@ static int unix_stream_splice_actor(struct sk_buff *skb,
 				    int skip, int chunk,
 				    struct unix_stream_read_state *state)
 {
+	/* MSG_ZEROCOPY pages are handed back to the sender as soon as the
+	 * skb is freed, so a pipe must not keep references to them.
+	 */
+	if (skb_orphan_frags_rx(skb, GFP_KERNEL))
+		return -ENOMEM;
+
 	return skb_splice_bits(skb, state->socket->sk,
 			       UNIXCB(skb).consumed + skip,
 			       state->pipe, chunk, state->splice_flags);
@@ -3107,7 +3225,8 @@ static __poll_t unix_poll(struct file *file, struct socket *sock, poll_table *wa
 	shutdown = READ_ONCE(sk->sk_shutdown);
 
 	/* exceptional events? */
-	if (READ_ONCE(sk->sk_err))
+	if (READ_ONCE(sk->sk_err) ||
+	    !skb_queue_empty_lockless(&sk->sk_error_queue))
 		mask |= EPOLLERR;
 	if (shutdown == SHUTDOWN_MASK)
 		mask |= EPOLLHUP;
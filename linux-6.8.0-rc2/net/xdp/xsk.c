@@ -781,9 +781,112 @@ free_err:
 	return ERR_PTR(err);
 }
 
+/* Hand a list of complete packets to the driver. This mirrors
+ * __dev_direct_xmit(), but takes the tx queue lock once for the whole list
+ * and sets xmit_more on all but the last packet, so the driver only has to
+ * kick the hardware once per batch. Packets that were not sent and can be
+ * handed back to user-space are left on @skbs, and always form the tail of
+ * what was read from the Tx ring.
+ */
+static int xsk_direct_xmit_list(struct xdp_sock *xs, struct sk_buff **skbs,
+				bool *sent_frame)
+{
+	struct sk_buff *skb, *segs, *next = NULL, **tail = skbs;
+	struct net_device *dev = xs->dev;
+	struct sk_buff *rest = NULL;
+	struct netdev_queue *txq;
+	int ret = NETDEV_TX_OK;
+	bool dropped = false;
+	bool again = false;
+	int err = 0;
+
+	for (skb = *skbs; skb; skb = next) {
+		next = skb->next;
+		skb_mark_not_on_list(skb);
+
+		segs = skb;
+		if (likely(netif_running(dev) && netif_carrier_ok(dev))) {
+			segs = validate_xmit_skb_list(skb, dev, &again);
+			if (likely(segs == skb)) {
+				skb_set_queue_mapping(skb, xs->queue_id);
+				*tail = skb;
+				tail = &skb->next;
+				continue;
+			}
+		}
+
+		/* SKB completed but not sent. Stop batching here, so that
+		 * everything behind it is handed back unvalidated.
+		 */
+		dev_core_stats_tx_dropped_inc(dev);
+		kfree_skb_list(segs);
+		*sent_frame = true;
+		dropped = true;
+		rest = next;
+		err = -EBUSY;
+		break;
+	}
+	*tail = NULL;
+
+	skb = *skbs;
+	if (!skb) {
+		*skbs = rest;
+		return rest ? -EAGAIN : err;
+	}
+
+	txq = skb_get_tx_queue(dev, skb);
+
+	local_bh_disable();
+	dev_xmit_recursion_inc();
+	HARD_TX_LOCK(dev, txq, smp_processor_id());
+	while (skb) {
+		if (netif_xmit_frozen_or_drv_stopped(txq)) {
+			ret = NETDEV_TX_BUSY;
+			break;
+		}
+
+		next = skb->next;
+		skb_mark_not_on_list(skb);
+
+		ret = netdev_start_xmit(skb, dev, txq, next != NULL);
+		if (ret == NETDEV_TX_BUSY) {
+			skb->next = next;
+			break;
+		}
+
+		/* Ignore NET_XMIT_CN as packet might have been sent */
+		if (ret == NET_XMIT_DROP)
+			err = -EBUSY;
+
+		*sent_frame = true;
+		skb = next;
+	}
+	HARD_TX_UNLOCK(dev, txq);
+	dev_xmit_recursion_dec();
+	local_bh_enable();
+
+	if (dropped) {
+		/* Handing these back would rewind the Tx ring past the
+		 * packet that was dropped above and send it a second time.
+		 */
+		for (; skb; skb = next) {
+			next = skb->next;
+			skb_mark_not_on_list(skb);
+			dev_core_stats_tx_dropped_inc(dev);
+			kfree_skb(skb);
+		}
+		*skbs = rest;
+		return rest ? -EAGAIN : err;
+	}
+
+	*skbs = skb;
+	return ret == NETDEV_TX_BUSY ? -EAGAIN : err;
+}
+
 static int __xsk_generic_xmit(struct sock *sk)
 {
 	struct xdp_sock *xs = xdp_sk(sk);
+	struct sk_buff *skbs = NULL, **tail = &skbs;
 	u32 max_batch = TX_BATCH_SIZE;
 	bool sent_frame = false;
 	struct xdp_desc desc;
@@ -801,7 +904,15 @@ static int __xsk_generic_xmit(struct sock *sk)
 	if (xs->queue_id >= xs->dev->real_num_tx_queues)
 		goto out;
 
-	while (xskq_cons_peek_desc(xs->tx, &desc, xs->pool)) {
+	/* Refresh the Tx ring once and only consume from the cached entries
+	 * below. Built packets are transmitted as one list at the end, and the
+	 * consumer pointer must not be published past any of them until the
+	 * driver has taken them, as they are handed back to user-space on
+	 * NETDEV_TX_BUSY.
+	 */
+	xskq_cons_get_entries(xs->tx);
+
+	while (xskq_cons_read_desc(xs->tx, &desc, xs->pool)) {
 		if (max_batch-- == 0) {
 			err = -EAGAIN;
 			goto out;
@@ -831,24 +942,8 @@ static int __xsk_generic_xmit(struct sock *sk)
 			continue;
 		}
 
-		err = __dev_direct_xmit(skb, xs->queue_id);
-		if  (err == NETDEV_TX_BUSY) {
-			/* Tell user-space to retry the send */
-			xskq_cons_cancel_n(xs->tx, xsk_get_num_desc(skb));
-			xsk_consume_skb(skb);
-			err = -EAGAIN;
-			goto out;
-		}
-
-		/* Ignore NET_XMIT_CN as packet might have been sent */
-		if (err == NET_XMIT_DROP) {
-			/* SKB completed but not sent */
-			err = -EBUSY;
-			xs->skb = NULL;
-			goto out;
-		}
-
-		sent_frame = true;
+		*tail = skb;
+		tail = &skb->next;
 		xs->skb = NULL;
 	}
 
@@ -859,6 +954,35 @@ static int __xsk_generic_xmit(struct sock *sk)
 	}
 
 out:
+	if (skbs) {
+		int ret = xsk_direct_xmit_list(xs, &skbs, &sent_frame);
+
+		if (skbs) {
+			/* Tell user-space to retry the sends the driver did
+			 * not take. Their descriptors and completion entries
+			 * are the most recently reserved ones, apart from
+			 * those of a partially built packet, so give that
+			 * one back as well.
+			 */
+			if (xs->skb) {
+				xskq_cons_cancel_n(xs->tx, xsk_get_num_desc(xs->skb));
+				xsk_consume_skb(xs->skb);
+			}
+
+			for (skb = skbs; skb; skb = skbs) {
+				skbs = skb->next;
+				skb_mark_not_on_list(skb);
+				xskq_cons_cancel_n(xs->tx, xsk_get_num_desc(skb));
+				xsk_consume_skb(skb);
+			}
+		}
+
+		if (ret)
+			err = ret;
+	}
+
+	__xskq_cons_release(xs->tx);
+
 	if (sent_frame)
 		if (xsk_tx_writeable(xs))
 			sk->sk_write_space(sk);
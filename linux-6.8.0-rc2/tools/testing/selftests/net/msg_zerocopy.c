@@ -17,6 +17,9 @@
  * PF_RDS
  * - SOCK_SEQPACKET
  *
+ * PF_UNIX
+ * - SOCK_STREAM
+ *
  * Start this program on two connected hosts, one in send mode and
  * the other with option '-r' to put it in receiver mode.
  *
@@ -42,6 +45,7 @@
 #include <netinet/ip6.h>
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
+#include <stddef.h>
 #include <poll.h>
 #include <sched.h>
 #include <stdbool.h>
@@ -54,6 +58,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <linux/rds.h>
@@ -74,6 +79,14 @@
 #define MSG_ZEROCOPY	0x4000000
 #endif
 
+#ifndef SOL_UNIX
+#define SOL_UNIX	288
+#endif
+
+#ifndef UNIX_RECVERR
+#define UNIX_RECVERR	1
+#endif
+
 static int  cfg_cork;
 static bool cfg_cork_mixed;
 static int  cfg_cpu		= -1;		/* default: pin to last cpu */
@@ -296,6 +309,7 @@ static void setup_sockaddr(int domain, const char *str_addr,
 {
 	struct sockaddr_in6 *addr6 = (void *) sockaddr;
 	struct sockaddr_in *addr4 = (void *) sockaddr;
+	struct sockaddr_un *addrun = (void *) sockaddr;
 
 	switch (domain) {
 	case PF_INET:
@@ -314,6 +328,15 @@ static void setup_sockaddr(int domain, const char *str_addr,
 		    inet_pton(AF_INET6, str_addr, &(addr6->sin6_addr)) != 1)
 			error(1, 0, "ipv6 parse error: %s", str_addr);
 		break;
+	case PF_UNIX:
+		/* abstract address, both ends must share a netns */
+		memset(addrun, 0, sizeof(*addrun));
+		addrun->sun_family = AF_UNIX;
+		cfg_alen = offsetof(struct sockaddr_un, sun_path) + 1 +
+			   snprintf(addrun->sun_path + 1,
+				    sizeof(addrun->sun_path) - 1,
+				    "msg_zerocopy.%d", cfg_port);
+		break;
 	default:
 		error(1, 0, "illegal domain");
 	}
@@ -417,6 +440,7 @@ static bool do_recv_completion(int fd, int domain)
 		error(1, 0, "cmsg: no cmsg");
 	if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
 	      (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR) ||
+	      (cm->cmsg_level == SOL_UNIX && cm->cmsg_type == UNIX_RECVERR) ||
 	      (cm->cmsg_level == SOL_PACKET && cm->cmsg_type == PACKET_TX_TIMESTAMP)))
 		error(1, 0, "serr: wrong type: %d.%d",
 		      cm->cmsg_level, cm->cmsg_type);
@@ -586,7 +610,8 @@ static int do_setup_rx(int domain, int type, int protocol)
 
 	do_setsockopt(fd, SOL_SOCKET, SO_RCVBUF, 1 << 21);
 	do_setsockopt(fd, SOL_SOCKET, SO_RCVLOWAT, 1 << 16);
-	do_setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, 1);
+	if (domain != PF_UNIX)
+		do_setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, 1);
 
 	if (bind(fd, (void *) &cfg_dst_addr, cfg_alen))
 		error(1, errno, "bind");
@@ -600,13 +625,17 @@ static int do_setup_rx(int domain, int type, int protocol)
 	return fd;
 }
 
-/* Flush all outstanding bytes for the tcp receive queue */
-static void do_flush_tcp(int fd)
+/* Flush all outstanding bytes for the tcp or unix receive queue */
+static void do_flush_tcp(int fd, int domain)
 {
+	static char buf[1 << 16];
 	int ret;
 
-	/* MSG_TRUNC flushes up to len bytes */
-	ret = recv(fd, NULL, 1 << 21, MSG_TRUNC | MSG_DONTWAIT);
+	/* MSG_TRUNC flushes up to len bytes, unix has to copy them out */
+	if (domain == PF_UNIX)
+		ret = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+	else
+		ret = recv(fd, NULL, 1 << 21, MSG_TRUNC | MSG_DONTWAIT);
 	if (ret == -1 && errno == EAGAIN)
 		return;
 	if (ret == -1)
@@ -659,7 +688,7 @@ static void do_rx(int domain, int type, int protocol)
 	tstop = gettimeofday_ms() + cfg_runtime_ms + cfg_receiver_wait_ms;
 	do {
 		if (type == SOCK_STREAM)
-			do_flush_tcp(fd);
+			do_flush_tcp(fd, domain);
 		else
 			do_flush_datagram(fd, type);
 
@@ -770,8 +799,12 @@ static void parse_opts(int argc, char **argv)
 		if (!cfg_rx && !saddr)
 			error(1, 0, "-S <client addr> required for PF_RDS\n");
 	}
-	setup_sockaddr(cfg_family, daddr, &cfg_dst_addr);
-	setup_sockaddr(cfg_family, saddr, &cfg_src_addr);
+	if (strcmp(cfg_test, "unix") == 0) {
+		setup_sockaddr(PF_UNIX, NULL, &cfg_dst_addr);
+	} else {
+		setup_sockaddr(cfg_family, daddr, &cfg_dst_addr);
+		setup_sockaddr(cfg_family, saddr, &cfg_src_addr);
+	}
 
 	if (cfg_payload_len > max_payload_len)
 		error(1, 0, "-s: payload exceeds max (%d)", max_payload_len);
@@ -804,6 +837,8 @@ int main(int argc, char **argv)
 		do_test(cfg_family, SOCK_DGRAM, 0);
 	else if (!strcmp(cfg_test, "rds"))
 		do_test(PF_RDS, SOCK_SEQPACKET, 0);
+	else if (!strcmp(cfg_test, "unix"))
+		do_test(PF_UNIX, SOCK_STREAM, 0);
 	else
 		error(1, 0, "unknown cfg_test %s", cfg_test);
 
@@ -27,13 +27,14 @@ if [[ "$#" -eq "0" ]]; then
 	$0 6 tcp -t 1
 	$0 4 udp -t 1
 	$0 6 udp -t 1
+	$0 4 unix -t 1
 	echo "OK. All tests passed"
 	exit 0
 fi
 
 # Argument parsing
 if [[ "$#" -lt "2" ]]; then
-	echo "Usage: $0 [4|6] [tcp|udp|raw|raw_hdrincl|packet|packet_dgram] <args>"
+	echo "Usage: $0 [4|6] [tcp|udp|raw|raw_hdrincl|packet|packet_dgram|unix] <args>"
 	exit 1
 fi
 
@@ -108,9 +109,15 @@ ip -netns "${NS2}" addr add       fd::2/64 dev "${DEV}" nodad
 
 do_test() {
 	local readonly ARGS="$1"
+	local RXNS="${NS2}"
+
+	# unix sockets cannot cross a netns boundary
+	if [[ "${TXMODE}" == "unix" ]]; then
+		RXNS="${NS1}"
+	fi
 
 	echo "ipv${IP} ${TXMODE} ${ARGS}"
-	ip netns exec "${NS2}" "${BIN}" "-${IP}" -i "${DEV}" -t 2 -C 2 -S "${SADDR}" -D "${DADDR}" ${ARGS} -r "${RXMODE}" &
+	ip netns exec "${RXNS}" "${BIN}" "-${IP}" -i "${DEV}" -t 2 -C 2 -S "${SADDR}" -D "${DADDR}" ${ARGS} -r "${RXMODE}" &
 	sleep 0.2
 	ip netns exec "${NS1}" "${BIN}" "-${IP}" -i "${DEV}" -t 1 -C 3 -S "${SADDR}" -D "${DADDR}" ${ARGS} "${TXMODE}"
 	wait
@@ -8,11 +8,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <arpa/inet.h>
 #include <linux/if.h>
+#include <linux/if_ether.h>
 #include <linux/if_tun.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 
 #include "../kselftest_harness.h"
@@ -39,6 +42,16 @@ static int tun_detach(int fd, char *dev)
 	return ioctl(fd, TUNSETQUEUE, (void *) &ifr);
 }
 
+static int tun_set_ring(int fd, struct tun_ring_req *req, __u32 nr_descs,
+			__u32 frame_size)
+{
+	memset(req, 0, sizeof(*req));
+	req->nr_descs = nr_descs;
+	req->frame_size = frame_size;
+
+	return ioctl(fd, TUNSETRING, req);
+}
+
 static int tun_alloc(char *dev)
 {
 	struct ifreq ifr;
@@ -159,4 +172,78 @@ TEST_F(tun, reattach_close_delete) {
 	EXPECT_EQ(tun_delete(self->ifname), 0);
 }
 
+TEST_F(tun, ring_setup) {
+	long page = sysconf(_SC_PAGESIZE);
+	struct tun_ring_req req;
+	void *area;
+
+	EXPECT_EQ(tun_set_ring(self->fd, &req, 48, 2048), -1);
+	EXPECT_EQ(errno, EINVAL);
+	EXPECT_EQ(tun_set_ring(self->fd, &req, 64, 64), -1);
+	EXPECT_EQ(errno, EINVAL);
+	/* over the size cap */
+	EXPECT_EQ(tun_set_ring(self->fd, &req, 4096, 64 * 1024), -1);
+	EXPECT_EQ(errno, EINVAL);
+
+	/* nothing to map before the rings are set up */
+	EXPECT_EQ(mmap(NULL, page, PROT_READ, MAP_SHARED, self->fd, 0),
+		  MAP_FAILED);
+
+	ASSERT_EQ(tun_set_ring(self->fd, &req, 64, 2048), 0);
+	EXPECT_EQ(tun_set_ring(self->fd, &req, 64, 2048), -1);
+	EXPECT_EQ(errno, EBUSY);
+
+	EXPECT_EQ(mmap(NULL, req.mmap_size + page, PROT_READ, MAP_SHARED,
+		       self->fd, 0), MAP_FAILED);
+	EXPECT_EQ(mmap(NULL, page, PROT_READ, MAP_SHARED, self->fd,
+		       req.mmap_size), MAP_FAILED);
+
+	area = mmap(NULL, req.mmap_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    self->fd, 0);
+	ASSERT_NE(area, MAP_FAILED);
+	EXPECT_EQ(munmap(area, req.mmap_size), 0);
+}
+
+TEST_F(tun, ring_rx_tx) {
+	struct tun_ring_desc *desc;
+	struct tun_ring_req req;
+	struct tun_pi *pi;
+	struct ethhdr *eth;
+	__u32 *prod, *cons;
+	char dummy = 0;
+	char *area;
+
+	ASSERT_EQ(fcntl(self->fd, F_SETFL, O_NONBLOCK), 0);
+	ASSERT_EQ(tun_set_ring(self->fd, &req, 64, 2048), 0);
+	area = mmap(NULL, req.mmap_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    self->fd, 0);
+	ASSERT_NE(area, MAP_FAILED);
+
+	/* nothing pending: no descriptor is produced */
+	prod = (__u32 *)(area + req.rx.producer);
+	EXPECT_EQ(read(self->fd, &dummy, sizeof(dummy)), -1);
+	EXPECT_EQ(errno, EAGAIN);
+	EXPECT_EQ(__atomic_load_n(prod, __ATOMIC_ACQUIRE), 0);
+
+	/* queue one minimal ethernet frame on the tx ring and send it */
+	pi = (struct tun_pi *)(area + req.tx.frames);
+	memset(pi, 0, sizeof(*pi) + ETH_ZLEN);
+	eth = (struct ethhdr *)(pi + 1);
+	memset(eth->h_dest, 0xff, ETH_ALEN);
+	eth->h_source[0] = 0x02;
+	eth->h_source[5] = 0x01;
+	eth->h_proto = htons(ETH_P_802_EX1);
+
+	desc = (struct tun_ring_desc *)(area + req.tx.desc);
+	desc[0].len = sizeof(*pi) + ETH_ZLEN;
+	prod = (__u32 *)(area + req.tx.producer);
+	cons = (__u32 *)(area + req.tx.consumer);
+	__atomic_store_n(prod, 1, __ATOMIC_RELEASE);
+
+	EXPECT_EQ(write(self->fd, &dummy, sizeof(dummy)), 1);
+	EXPECT_EQ(__atomic_load_n(cons, __ATOMIC_ACQUIRE), 1);
+
+	EXPECT_EQ(munmap(area, req.mmap_size), 0);
+}
+
 TEST_HARNESS_MAIN